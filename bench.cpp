@@ -0,0 +1,184 @@
+/* Copyright (c) 2025, Rye Stahle-Smith
+December 2nd, 2025 - bench.cpp
+Description: Kernel microbenchmarks (pipe throughput, kmalloc/kfree rate, syscall round trip) with MB/s and ops/ms reporting. */
+#include "bench.h"
+#include "shell.h"
+#include "timer.h"
+#include "pipe.h"
+#include "memory.h"
+#include "scheduler.h"
+
+#define BENCH_PIPE_BYTES (4 * 1024 * 1024)
+#define BENCH_PIPE_CHUNK 512
+#define BENCH_ALLOC_ROUNDS 20000
+#define BENCH_ALLOC_BATCH 32
+#define BENCH_SYSCALL_CALLS 200000
+
+static uint64_t bench_cycles() {
+    uint64_t c;
+    asm volatile("csrr %0, mcycle" : "=r"(c));
+    return c;
+}
+
+static void print_u64(uint64_t v) {
+    char buf[24];
+    int n = 0;
+    do { buf[n++] = '0' + v % 10; v /= 10; } while (v);
+    while (n) putchar(buf[--n]);
+}
+
+void bench_report(const char* name, uint64_t bytes, uint64_t ticks) {
+    if (ticks == 0) ticks = 1;
+
+    // Tenths of a MB/s, in integer math (ticks are TIMER_TICKS_PER_MS per ms)
+    uint64_t mbps10 = bytes * 10 * TIMER_TICKS_PER_MS * 1000 / (ticks * 1024 * 1024);
+
+    print_str(name);
+    print_str(": ");
+    print_u64(bytes);
+    print_str(" bytes in ");
+    print_u64(ticks / TIMER_TICKS_PER_MS);
+    print_str(" ms (");
+    print_u64(mbps10 / 10);
+    putchar('.');
+    putchar('0' + mbps10 % 10);
+    print_str(" MB/s)\n");
+}
+
+// Print "<name>: <ops> ops in <ms> ms (<ops/ms>)" for a timed run
+static void bench_report_ops(const char* name, uint64_t ops, uint64_t ticks) {
+    if (ticks == 0) ticks = 1;
+
+    print_str(name);
+    print_str(": ");
+    print_u64(ops);
+    print_str(" ops in ");
+    print_u64(ticks / TIMER_TICKS_PER_MS);
+    print_str(" ms (");
+    print_u64(ops * TIMER_TICKS_PER_MS / ticks);
+    print_str(" ops/ms)\n");
+}
+
+// ---------------------------------------------------------------------
+// Benchmarks
+// ---------------------------------------------------------------------
+
+// Stream data through one pipe in chunks, alternating writer and reader the
+// way two cooperating processes would, and verify the bytes that come out
+static void bench_pipe() {
+    Pipe* p = pipe_create();
+    if (!p) {
+        print_str("pipe: no free pipes\n");
+        return;
+    }
+
+    static uint8_t out[BENCH_PIPE_CHUNK];
+    static uint8_t in[BENCH_PIPE_CHUNK];
+    for (int i = 0; i < BENCH_PIPE_CHUNK; i++) out[i] = (uint8_t)i;
+
+    uint64_t moved = 0;
+    bool ok = true;
+    uint64_t start = timer_now();
+    while (moved < BENCH_PIPE_BYTES) {
+        int n = pipe_write(p, out, BENCH_PIPE_CHUNK);
+        if (pipe_read(p, in, n) != n || in[n - 1] != out[n - 1]) {
+            ok = false;
+            break;
+        }
+        moved += n;
+    }
+    uint64_t ticks = timer_now() - start;
+
+    pipe_close_write(p);
+    pipe_close_read(p);
+
+    if (!ok) print_str("pipe: data mismatch\n");
+    else bench_report("pipe", moved, ticks);
+}
+
+// Allocate a batch of mixed small sizes and free it in reverse, so nearly
+// every call is served by the hart's magazines rather than the depot
+static void bench_kmalloc() {
+    static void* objs[BENCH_ALLOC_BATCH];
+    static const uint64_t sizes[] = { 16, 24, 64, 100, 256, 512, 1024, 48 };
+
+    uint64_t ops = 0;
+    bool ok = true;
+    uint64_t start = timer_now();
+    for (int r = 0; r < BENCH_ALLOC_ROUNDS && ok; r++) {
+        for (int i = 0; i < BENCH_ALLOC_BATCH; i++) {
+            objs[i] = kmalloc(sizes[i % 8], MEM_BENCH);
+            if (!objs[i]) {
+                ok = false;
+                break;
+            }
+            *(uint8_t*)objs[i] = (uint8_t)i;
+            ops++;
+        }
+        for (int i = BENCH_ALLOC_BATCH - 1; i >= 0; i--) {
+            if (!objs[i]) continue;
+            if (*(uint8_t*)objs[i] != (uint8_t)i) ok = false;
+            kfree(objs[i]);
+            objs[i] = nullptr;
+            ops++;
+        }
+    }
+    uint64_t ticks = timer_now() - start;
+
+    if (!ok) print_str("kmalloc: allocation failed or corrupted\n");
+    else bench_report_ops("kmalloc", ops, ticks);
+}
+
+// Round trips through the trap vector with the cheapest syscall there is;
+// the trap restores every register but a0, so only a0 and a7 are operands
+static void bench_syscall() {
+    register uint64_t a0 asm("a0");
+    register uint64_t a7 asm("a7") = SYSCALL_GETPID;
+
+    uint64_t start = timer_now();
+    uint64_t cycles = bench_cycles();
+    for (int i = 0; i < BENCH_SYSCALL_CALLS; i++) {
+        asm volatile("ecall" : "=r"(a0) : "r"(a7) : "memory");
+    }
+    cycles = bench_cycles() - cycles;
+    uint64_t ticks = timer_now() - start;
+
+    if ((int64_t)a0 != scheduler_current_tgid()) {
+        print_str("syscall: getpid returned the wrong pid\n");
+        return;
+    }
+    bench_report_ops("syscall", BENCH_SYSCALL_CALLS, ticks);
+    print_str("syscall: ");
+    print_u64(cycles / BENCH_SYSCALL_CALLS);
+    print_str(" cycles per round trip\n");
+}
+
+struct Benchmark {
+    const char* name;
+    void (*run)();
+};
+
+static const Benchmark benchmarks[] = {
+    { "pipe", bench_pipe },
+    { "kmalloc", bench_kmalloc },
+    { "syscall", bench_syscall },
+};
+
+static const int BENCH_COUNT = sizeof(benchmarks) / sizeof(benchmarks[0]);
+
+// ---------------------------------------------------------------------
+// Shell commands (registered through BENCH_COMMANDS)
+// ---------------------------------------------------------------------
+void cmd_bench(const char* args) {
+    bool all = !args || args[0] == '\0';
+    bool found = false;
+
+    for (int i = 0; i < BENCH_COUNT; i++) {
+        if (all || strcmp(args, benchmarks[i].name) == 0) {
+            benchmarks[i].run();
+            found = true;
+        }
+    }
+
+    if (!found) shell_fail("Unknown benchmark\n");
+}
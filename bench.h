@@ -0,0 +1,17 @@
+/* Copyright (c) 2025, Rye Stahle-Smith
+December 2nd, 2025 - bench.h
+Description: Kernel microbenchmarks run from the shell, timed with the machine timer. */
+#ifndef BENCH_H
+#define BENCH_H
+
+#pragma once
+#include <stdint.h>
+
+// Print "<name>: <bytes> bytes in <ms> ms (<MB/s>)" for a timed run
+void bench_report(const char* name, uint64_t bytes, uint64_t ticks);
+
+// Shell commands provided by the benchmarks (see commands.h)
+#define BENCH_COMMANDS(CMD) \
+    CMD("bench", cmd_bench, "'bench [name]'\tRun kernel benchmarks (all, or one of: pipe, kmalloc, syscall).")
+
+#endif
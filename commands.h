@@ -0,0 +1,112 @@
+/* Copyright (c) 2025, Rye Stahle-Smith
+December 2nd, 2025 - commands.h
+Description: Shell command table assembled from every subsystem's command list, with a perfect hash computed at compile time for dispatch. */
+#ifndef COMMANDS_H
+#define COMMANDS_H
+
+#pragma once
+#include <stdint.h>
+#include "shell.h"
+#include "fat.h"
+#include "scheduler.h"
+#include "bench.h"
+#include "memory.h"
+#include "emulate.h"
+
+// Every registered command, in help order
+#define ALL_COMMANDS(CMD) \
+    SHELL_COMMANDS(CMD) \
+    FAT_COMMANDS(CMD) \
+    SCHEDULER_COMMANDS(CMD) \
+    MEMORY_COMMANDS(CMD) \
+    EMULATE_COMMANDS(CMD) \
+    BENCH_COMMANDS(CMD)
+
+struct Command {
+    const char* name;
+    void (*func)(const char* args);
+    const char* help;
+};
+
+// Handlers may live in any subsystem's translation unit
+#define COMMAND_DECLARE(name, func, help) void func(const char* args);
+ALL_COMMANDS(COMMAND_DECLARE)
+#undef COMMAND_DECLARE
+
+// Table in registration order, terminated by a null entry
+extern const Command commands[];
+
+// ---------------------------------------------------------------------
+// Compile-time perfect hash
+// The compiler searches for a seed under which every command name lands in
+// its own slot, so a lookup is one hash, one table read and one strcmp.
+// Adding a command simply makes the compiler find a different seed.
+// ---------------------------------------------------------------------
+namespace command_hash {
+
+constexpr uint32_t hash(const char* s, uint32_t seed) {
+    uint32_t h = 2166136261u ^ seed;
+    while (*s) h = (h ^ (uint8_t)*s++) * 16777619u;
+    // Final avalanche so the seed reaches the low (slot) bits
+    h ^= h >> 16;
+    h *= 0x85ebca6bu;
+    h ^= h >> 13;
+    return h;
+}
+
+#define COMMAND_NAME(name, func, help) name,
+constexpr const char* names[] = { ALL_COMMANDS(COMMAND_NAME) };
+#undef COMMAND_NAME
+
+constexpr int COUNT = sizeof(names) / sizeof(names[0]);
+
+// Power of two with at least 4 slots per command keeps the seed search short
+constexpr int table_size() {
+    int n = 1;
+    while (n < 4 * COUNT) n <<= 1;
+    return n;
+}
+constexpr int TABLE_SIZE = table_size();
+constexpr uint32_t MASK = TABLE_SIZE - 1;
+
+constexpr bool seed_is_perfect(uint32_t seed) {
+    bool used[TABLE_SIZE] = {};
+    for (int i = 0; i < COUNT; i++) {
+        uint32_t slot = hash(names[i], seed) & MASK;
+        if (used[slot]) return false;
+        used[slot] = true;
+    }
+    return true;
+}
+
+constexpr uint32_t find_seed() {
+    uint32_t seed = 0;
+    while (!seed_is_perfect(seed)) seed++;
+    return seed;
+}
+constexpr uint32_t SEED = find_seed();
+
+struct Table {
+    int8_t index[TABLE_SIZE];  // command index per slot, -1 if empty
+};
+
+constexpr Table build_table() {
+    Table t = {};
+    for (int i = 0; i < TABLE_SIZE; i++) t.index[i] = -1;
+    for (int i = 0; i < COUNT; i++) t.index[hash(names[i], SEED) & MASK] = (int8_t)i;
+    return t;
+}
+constexpr Table TABLE = build_table();
+
+static_assert(COUNT < 128, "command index must fit in int8_t");
+
+} // namespace command_hash
+
+// Look up a command by name; nullptr if it is not registered
+inline const Command* find_command(const char* name) {
+    int i = command_hash::TABLE.index[command_hash::hash(name, command_hash::SEED) & command_hash::MASK];
+    if (i < 0 || strcmp(commands[i].name, name) != 0) return nullptr;
+    return &commands[i];
+}
+
+#endif
@@ -0,0 +1,296 @@
+/* Copyright (c) 2025, Rye Stahle-Smith
+December 2nd, 2025 - editor.cpp
+Description: Gap-buffer screen editor with cursor movement, minimal line redraws over the UART, and whole-file saves back to the filesystem. */
+#include "editor.h"
+#include "shell.h"
+#include "fat.h"
+
+#define TEXT_ROWS (EDITOR_ROWS - 1)
+#define NO_HASH 0xFFFFFFFFu
+
+// Control keys
+#define KEY_CTRL_A 1
+#define KEY_CTRL_D 4
+#define KEY_CTRL_E 5
+#define KEY_CTRL_Q 17
+#define KEY_CTRL_S 19
+
+// ---------------------------------------------------------------------
+// Gap buffer
+// ---------------------------------------------------------------------
+static int gb_length(const GapBuffer* gb) { return gb->cap - (gb->gap_end - gb->gap_start); }
+
+static uint8_t gb_at(const GapBuffer* gb, int i) {
+    return (i < gb->gap_start) ? gb->buf[i] : gb->buf[i + gb->gap_end - gb->gap_start];
+}
+
+// Slide the gap so the cursor sits at pos
+static void gb_move_to(GapBuffer* gb, int pos) {
+    if (pos < 0) pos = 0;
+    if (pos > gb_length(gb)) pos = gb_length(gb);
+
+    while (gb->gap_start > pos) gb->buf[--gb->gap_end] = gb->buf[--gb->gap_start];
+    while (gb->gap_start < pos) gb->buf[gb->gap_start++] = gb->buf[gb->gap_end++];
+}
+
+static bool gb_insert(GapBuffer* gb, uint8_t c) {
+    if (gb->gap_start == gb->gap_end) return false;  // full
+    gb->buf[gb->gap_start++] = c;
+    return true;
+}
+
+static bool gb_backspace(GapBuffer* gb) {
+    if (gb->gap_start == 0) return false;
+    gb->gap_start--;
+    return true;
+}
+
+static bool gb_delete(GapBuffer* gb) {
+    if (gb->gap_end == gb->cap) return false;
+    gb->gap_end++;
+    return true;
+}
+
+// Offset of the first byte of the line containing pos
+static int gb_line_start(const GapBuffer* gb, int pos) {
+    while (pos > 0 && gb_at(gb, pos - 1) != '\n') pos--;
+    return pos;
+}
+
+// Offset of the '\n' ending the line containing pos (or the text length)
+static int gb_line_end(const GapBuffer* gb, int pos) {
+    int len = gb_length(gb);
+    while (pos < len && gb_at(gb, pos) != '\n') pos++;
+    return pos;
+}
+
+// ---------------------------------------------------------------------
+// Editor state and rendering
+// Each screen row remembers a hash of what it last showed; a redraw only
+// sends rows whose hash changed, which keeps typing to a single row.
+// ---------------------------------------------------------------------
+struct Editor {
+    GapBuffer gb;
+    File* file;
+    int top_line;               // first visible line
+    int left_col;               // first visible column
+    uint32_t shown[EDITOR_ROWS];
+    bool dirty;
+    bool quit_armed;            // ^Q pressed once with unsaved changes
+    const char* message;
+};
+
+static uint8_t edit_storage[MAX_FILE_SIZE];
+static Editor ed;
+
+static uint32_t hash_step(uint32_t h, uint8_t c) { return (h ^ c) * 16777619u; }
+
+static void move_cursor(int row, int col) {
+    char buf[16];
+    print_str("\033[");
+    itoa(row + 1, buf, 10);
+    print_str(buf);
+    putchar(';');
+    itoa(col + 1, buf, 10);
+    print_str(buf);
+    putchar('H');
+}
+
+// Draw a row if its content differs from what is on screen
+static void draw_row(int row, uint32_t hash, const char* text, int len) {
+    if (ed.shown[row] == hash) return;
+    ed.shown[row] = hash;
+
+    move_cursor(row, 0);
+    for (int i = 0; i < len; i++) putchar(text[i]);
+    print_str("\033[K");  // clear to end of line
+}
+
+static void render() {
+    GapBuffer* gb = &ed.gb;
+    int len = gb_length(gb);
+    int cursor = gb->gap_start;
+
+    // Cursor line and column
+    int cur_line = 0;
+    for (int i = 0; i < cursor; i++) if (gb_at(gb, i) == '\n') cur_line++;
+    int cur_col = cursor - gb_line_start(gb, cursor);
+
+    // Scroll so the cursor stays visible
+    if (cur_line < ed.top_line) ed.top_line = cur_line;
+    if (cur_line >= ed.top_line + TEXT_ROWS) ed.top_line = cur_line - TEXT_ROWS + 1;
+    if (cur_col < ed.left_col) ed.left_col = cur_col;
+    if (cur_col >= ed.left_col + EDITOR_COLS) ed.left_col = cur_col - EDITOR_COLS + 1;
+
+    // Offset of the first visible line
+    int off = 0;
+    for (int line = 0; line < ed.top_line && off < len; off++) {
+        if (gb_at(gb, off) == '\n') line++;
+    }
+
+    char text[EDITOR_COLS];
+    for (int row = 0; row < TEXT_ROWS; row++) {
+        int n = 0;
+        uint32_t h = hash_step(2166136261u, (uint8_t)ed.left_col);
+
+        if (off > len) {
+            text[n++] = '~';  // past the end of the text
+            h = hash_step(h, '~');
+            h = hash_step(h, 0xFF);
+        } else {
+            int end = gb_line_end(gb, off);
+            for (int i = off + ed.left_col; i < end && n < EDITOR_COLS; i++) {
+                text[n] = (char)gb_at(gb, i);
+                h = hash_step(h, (uint8_t)text[n++]);
+            }
+            off = end + 1;
+        }
+        draw_row(row, h, text, n);
+    }
+
+    // Status line
+    char status[EDITOR_COLS];
+    char num[16];
+    status[0] = '\0';
+    strcat(status, " ");
+    strcat(status, ed.file->name);
+    strcat(status, ed.dirty ? " [+]  " : "  ");
+    itoa(cur_line + 1, num, 10);
+    strcat(status, num);
+    strcat(status, ":");
+    itoa(cur_col + 1, num, 10);
+    strcat(status, num);
+    strcat(status, "  ");
+    strcat(status, ed.message ? ed.message : "^S save  ^D save+exit  ^Q quit");
+
+    uint32_t h = 2166136261u;
+    for (int i = 0; status[i]; i++) h = hash_step(h, (uint8_t)status[i]);
+    if (ed.shown[TEXT_ROWS] != h) {
+        print_str("\033[7m");  // reverse video
+        draw_row(TEXT_ROWS, h, status, strlen(status));
+        print_str("\033[0m");
+    }
+
+    move_cursor(cur_line - ed.top_line, cur_col - ed.left_col);
+}
+
+// ---------------------------------------------------------------------
+// Commands
+// ---------------------------------------------------------------------
+
+// Replace the file's contents in one step; the inode is never left half written
+static void save() {
+    Inode* ino = ed.file->inode;
+    GapBuffer* gb = &ed.gb;
+    int after = gb->cap - gb->gap_end;
+
+    memcpy(ino->data, gb->buf, gb->gap_start);
+    memcpy(ino->data + gb->gap_start, gb->buf + gb->gap_end, after);
+    ino->size = gb->gap_start + after;
+    fat.mark_modified(ino);
+
+    ed.dirty = false;
+    ed.message = "Saved.";
+}
+
+static void move_vertical(int dir) {
+    GapBuffer* gb = &ed.gb;
+    int cursor = gb->gap_start;
+    int ls = gb_line_start(gb, cursor);
+    int col = cursor - ls;
+
+    if (dir < 0) {
+        if (ls == 0) return;
+        int prev = gb_line_start(gb, ls - 1);
+        int width = (ls - 1) - prev;
+        gb_move_to(gb, prev + (col < width ? col : width));
+    } else {
+        int le = gb_line_end(gb, cursor);
+        if (le == gb_length(gb)) return;
+        int next = le + 1;
+        int width = gb_line_end(gb, next) - next;
+        gb_move_to(gb, next + (col < width ? col : width));
+    }
+}
+
+// Handle "ESC [ x" and "ESC [ n ~" sequences
+static void handle_escape() {
+    GapBuffer* gb = &ed.gb;
+    if (getchar() != '[') return;
+
+    char c = getchar();
+    if (c >= '0' && c <= '9') {
+        if (getchar() == '~' && c == '3' && gb_delete(gb)) ed.dirty = true;  // Delete
+        return;
+    }
+
+    switch (c) {
+        case 'A': move_vertical(-1); break;
+        case 'B': move_vertical(1); break;
+        case 'C': gb_move_to(gb, gb->gap_start + 1); break;
+        case 'D': gb_move_to(gb, gb->gap_start - 1); break;
+        case 'H': gb_move_to(gb, gb_line_start(gb, gb->gap_start)); break;
+        case 'F': gb_move_to(gb, gb_line_end(gb, gb->gap_start)); break;
+    }
+}
+
+void editor_run(File* f, bool at_end) {
+    Inode* ino = f->inode;
+
+    // Load the file with the gap after its contents, then place the cursor
+    ed.gb.buf = edit_storage;
+    ed.gb.cap = MAX_FILE_SIZE;
+    memcpy(edit_storage, ino->data, ino->size);
+    ed.gb.gap_start = ino->size;
+    ed.gb.gap_end = MAX_FILE_SIZE;
+    if (!at_end) gb_move_to(&ed.gb, 0);
+
+    ed.file = f;
+    ed.top_line = 0;
+    ed.left_col = 0;
+    ed.dirty = false;
+    ed.quit_armed = false;
+    ed.message = nullptr;
+    for (int i = 0; i < EDITOR_ROWS; i++) ed.shown[i] = NO_HASH;
+
+    print_str("\033[2J");
+    while (1) {
+        render();
+
+        char c = getchar();
+        const char* prev_message = ed.message;
+        ed.message = nullptr;
+
+        if (c == KEY_CTRL_Q) {
+            if (!ed.dirty || ed.quit_armed) break;
+            ed.quit_armed = true;
+            ed.message = "Unsaved changes! ^Q again to discard.";
+            continue;
+        }
+        ed.quit_armed = false;
+
+        if (c == KEY_CTRL_S) {
+            save();
+        } else if (c == KEY_CTRL_D) {
+            save();
+            break;
+        } else if (c == 0x1B) {
+            handle_escape();
+        } else if (c == KEY_CTRL_A) {
+            gb_move_to(&ed.gb, gb_line_start(&ed.gb, ed.gb.gap_start));
+        } else if (c == KEY_CTRL_E) {
+            gb_move_to(&ed.gb, gb_line_end(&ed.gb, ed.gb.gap_start));
+        } else if (c == '\b' || c == 127) {
+            if (gb_backspace(&ed.gb)) ed.dirty = true;
+        } else if (c == '\r' || c == '\n' || c == '\t' || (c >= 32 && c < 127)) {
+            if (c == '\r') c = '\n';   // store LF only
+            if (c == '\t') c = ' ';    // keep columns predictable on the console
+            if (gb_insert(&ed.gb, (uint8_t)c)) ed.dirty = true;
+            else ed.message = "File is full.";
+        } else {
+            ed.message = prev_message;
+        }
+    }
+
+    print_str("\033[2J\033[H");
+}
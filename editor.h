@@ -0,0 +1,27 @@
+/* Copyright (c) 2025, Rye Stahle-Smith
+December 2nd, 2025 - editor.h
+Description: Full-screen text editor interface built on a gap buffer, rendered over the UART with ANSI escape sequences. */
+#ifndef EDITOR_H
+#define EDITOR_H
+
+#pragma once
+#include <stdint.h>
+
+#define EDITOR_ROWS 24  // terminal rows; the last one is the status line
+#define EDITOR_COLS 80
+
+struct File;
+
+// Text with a movable gap at the cursor, so edits at the cursor are O(1)
+struct GapBuffer {
+    uint8_t* buf;
+    int cap;
+    int gap_start;  // cursor offset
+    int gap_end;
+};
+
+// Edit a file in place; the file is only written on save. Returns when the
+// user exits. at_end places the cursor after the last byte.
+void editor_run(File* f, bool at_end);
+
+#endif
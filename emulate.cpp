@@ -0,0 +1,360 @@
+/* Copyright (c) 2025, Rye Stahle-Smith
+December 2nd, 2025 - emulate.cpp
+Description: Trap-time emulation of misaligned loads/stores and of Zba/Zbb instructions the hart lacks, with per-process counters. */
+#include "emulate.h"
+#include "shell.h"
+
+#define CAUSE_ILLEGAL_INSN 2
+#define CAUSE_LOAD_MISALIGNED 4
+#define CAUSE_STORE_MISALIGNED 6
+
+#define RAM_BASE 0x80000000ULL  // ORIGIN(RAM) in linker.ld
+extern uint8_t _stack_start;    // end of RAM
+
+static uint32_t emu_enabled = EMU_MISALIGNED | EMU_ZBA | EMU_ZBB;
+
+// ---------------------------------------------------------------------
+// Register and memory access
+// ---------------------------------------------------------------------
+
+// TrapFrame slot of each integer register x0-x31 (x0 has none)
+static const int8_t reg_slot[32] = {
+    -1, 0, 30, 1, 2, 3, 4, 5,          // zero ra sp gp tp t0 t1 t2
+    10, 11,                             // s0 s1
+    22, 23, 24, 25, 26, 27, 28, 29,     // a0-a7
+    12, 13, 14, 15, 16, 17, 18, 19, 20, 21,  // s2-s11
+    6, 7, 8, 9                          // t3-t6
+};
+
+static uint64_t get_reg(const TrapFrame* tf, int r) {
+    return r ? ((const uint64_t*)tf)[reg_slot[r]] : 0;
+}
+
+static void set_reg(TrapFrame* tf, int r, uint64_t value) {
+    if (r) ((uint64_t*)tf)[reg_slot[r]] = value;
+}
+
+// Only plain RAM is touched byte by byte; anything else stays a fault
+static bool in_ram(uint64_t addr, int size) {
+    return addr >= RAM_BASE && addr + size <= (uint64_t)&_stack_start && addr + size > addr;
+}
+
+static uint64_t sext32(uint64_t v) {
+    return (uint64_t)(int64_t)(int32_t)v;
+}
+
+// Read the instruction at pc one halfword at a time (pc is only 2-aligned)
+static bool fetch(uint64_t pc, uint32_t* insn, int* len) {
+    if (!in_ram(pc, 2)) return false;
+    uint16_t lo = *(volatile uint16_t*)pc;
+    if ((lo & 3) != 3) {
+        *insn = lo;
+        *len = 2;
+        return true;
+    }
+
+    if (!in_ram(pc + 2, 2)) return false;
+    uint16_t hi = *(volatile uint16_t*)(pc + 2);
+    *insn = lo | ((uint32_t)hi << 16);
+    *len = 4;
+    return true;
+}
+
+// ---------------------------------------------------------------------
+// Misaligned loads and stores
+// ---------------------------------------------------------------------
+struct Access {
+    bool store;
+    int reg;       // rd for loads, rs2 for stores
+    int size;      // bytes
+    bool sign;     // sign-extend a load
+    uint64_t addr;
+};
+
+// Integer loads/stores: the base forms and the compressed c.lw/c.ld/c.sw/
+// c.sd and their sp-relative variants
+static bool decode_access(const TrapFrame* tf, uint32_t insn, int len, Access* acc) {
+    if (len == 4) {
+        uint32_t opcode = insn & 0x7f;
+        uint32_t f3 = (insn >> 12) & 7;
+        int rs1 = (insn >> 15) & 31;
+
+        if (opcode == 0x03 && f3 != 7) {           // lb lh lw ld lbu lhu lwu
+            *acc = { false, (int)((insn >> 7) & 31), 1 << (f3 & 3), (f3 & 4) == 0,
+                     get_reg(tf, rs1) + ((int64_t)(int32_t)insn >> 20) };
+            return true;
+        }
+        if (opcode == 0x23 && f3 <= 3) {           // sb sh sw sd
+            int64_t imm = (((int64_t)(int32_t)insn >> 25) << 5) | ((insn >> 7) & 31);
+            *acc = { true, (int)((insn >> 20) & 31), 1 << f3, false, get_reg(tf, rs1) + imm };
+            return true;
+        }
+        return false;
+    }
+
+    uint32_t quadrant = insn & 3;
+    uint32_t f3 = (insn >> 13) & 7;
+    uint64_t off;
+
+    if (quadrant == 0 && f3 >= 2 && (f3 & 3) >= 2) {  // c.lw c.ld c.sw c.sd
+        bool word = (f3 & 1) == 0;
+        off = ((insn >> 10) & 7) << 3;
+        off |= word ? (((insn >> 6) & 1) << 2) | (((insn >> 5) & 1) << 6)
+                    : ((insn >> 5) & 3) << 6;
+        *acc = { f3 >= 6, (int)((insn >> 2) & 7) + 8, word ? 4 : 8, true,
+                 get_reg(tf, ((insn >> 7) & 7) + 8) + off };
+        return true;
+    }
+
+    if (quadrant == 2 && (f3 & 3) >= 2) {             // c.lwsp c.ldsp c.swsp c.sdsp
+        bool store = f3 >= 6;
+        bool word = (f3 & 1) == 0;
+        if (!store && word) {
+            off = (((insn >> 12) & 1) << 5) | (((insn >> 4) & 7) << 2) | (((insn >> 2) & 3) << 6);
+        } else if (!store) {
+            off = (((insn >> 12) & 1) << 5) | (((insn >> 5) & 3) << 3) | (((insn >> 2) & 7) << 6);
+        } else if (word) {
+            off = (((insn >> 9) & 15) << 2) | (((insn >> 7) & 3) << 6);
+        } else {
+            off = (((insn >> 10) & 7) << 3) | (((insn >> 7) & 7) << 6);
+        }
+        int reg = store ? (insn >> 2) & 31 : (insn >> 7) & 31;
+        *acc = { store, reg, word ? 4 : 8, true, get_reg(tf, 2) + off };
+        return true;
+    }
+
+    return false;
+}
+
+static bool emulate_access(TrapFrame* tf, uint32_t insn, int len) {
+    Access acc;
+    if (!decode_access(tf, insn, len, &acc)) return false;
+    if (acc.store != (tf->cause == CAUSE_STORE_MISALIGNED)) return false;
+    if (!in_ram(acc.addr, acc.size)) return false;
+
+    volatile uint8_t* mem = (volatile uint8_t*)acc.addr;
+    if (acc.store) {
+        uint64_t value = get_reg(tf, acc.reg);
+        for (int i = 0; i < acc.size; ++i) mem[i] = (uint8_t)(value >> (8 * i));
+        return true;
+    }
+
+    uint64_t value = 0;
+    for (int i = 0; i < acc.size; ++i) value |= (uint64_t)mem[i] << (8 * i);
+    if (acc.sign && acc.size < 8) {
+        int shift = 64 - 8 * acc.size;
+        value = (uint64_t)((int64_t)(value << shift) >> shift);
+    }
+    set_reg(tf, acc.reg, value);
+    return true;
+}
+
+// ---------------------------------------------------------------------
+// Zba / Zbb
+// ---------------------------------------------------------------------
+
+// Plain loops: the compiler would turn builtins into libgcc calls
+static uint64_t count_leading_zeros(uint64_t x) {
+    uint64_t n = 0;
+    for (uint64_t bit = 1ULL << 63; bit && !(x & bit); bit >>= 1) n++;
+    return n;
+}
+
+static uint64_t count_trailing_zeros(uint64_t x) {
+    uint64_t n = 0;
+    for (uint64_t bit = 1; bit && !(x & bit); bit <<= 1) n++;
+    return n;
+}
+
+static uint64_t count_ones(uint64_t x) {
+    uint64_t n = 0;
+    for (; x; x &= x - 1) n++;
+    return n;
+}
+
+static uint64_t rotate_left(uint64_t x, int n, int width) {
+    n &= width - 1;
+    if (width == 32) {
+        uint32_t w = (uint32_t)x;
+        return sext32(n ? (w << n) | (w >> (32 - n)) : w);
+    }
+    return n ? (x << n) | (x >> (64 - n)) : x;
+}
+
+// Compute the result of a Zba/Zbb instruction from its source registers;
+// false if insn is none of them or its extension is switched off
+static bool exec_bitmanip(uint32_t insn, uint64_t a, uint64_t b, uint64_t* out) {
+    uint32_t opcode = insn & 0x7f;
+    uint32_t f3 = (insn >> 12) & 7;
+    uint32_t f7 = insn >> 25;
+    uint32_t imm = insn >> 20;
+    bool zba = emu_enabled & EMU_ZBA;
+    bool zbb = emu_enabled & EMU_ZBB;
+
+    if (opcode == 0x33) {                          // OP
+        if (zba && f7 == 0x10 && (f3 == 2 || f3 == 4 || f3 == 6)) {
+            *out = (a << (f3 / 2)) + b;            // sh1add sh2add sh3add
+            return true;
+        }
+        if (zbb && f7 == 0x20 && f3 == 7) { *out = a & ~b; return true; }    // andn
+        if (zbb && f7 == 0x20 && f3 == 6) { *out = a | ~b; return true; }    // orn
+        if (zbb && f7 == 0x20 && f3 == 4) { *out = ~(a ^ b); return true; }  // xnor
+        if (zbb && f7 == 0x05 && f3 >= 4) {
+            bool take_a;
+            if (f3 == 4) take_a = (int64_t)a < (int64_t)b;        // min
+            else if (f3 == 5) take_a = a < b;                     // minu
+            else if (f3 == 6) take_a = (int64_t)a > (int64_t)b;   // max
+            else take_a = a > b;                                  // maxu
+            *out = take_a ? a : b;
+            return true;
+        }
+        if (zbb && f7 == 0x30 && f3 == 1) { *out = rotate_left(a, b & 63, 64); return true; }          // rol
+        if (zbb && f7 == 0x30 && f3 == 5) { *out = rotate_left(a, 64 - (b & 63), 64); return true; }   // ror
+        return false;
+    }
+
+    if (opcode == 0x3b) {                          // OP-32
+        if (zba && f7 == 0x04 && f3 == 0) { *out = (a & 0xffffffffULL) + b; return true; }  // add.uw
+        if (zba && f7 == 0x10 && (f3 == 2 || f3 == 4 || f3 == 6)) {
+            *out = ((a & 0xffffffffULL) << (f3 / 2)) + b;                                  // shNadd.uw
+            return true;
+        }
+        if (zbb && f7 == 0x04 && f3 == 4 && ((insn >> 20) & 31) == 0) { *out = a & 0xffff; return true; }  // zext.h
+        if (zbb && f7 == 0x30 && f3 == 1) { *out = rotate_left(a, b & 31, 32); return true; }         // rolw
+        if (zbb && f7 == 0x30 && f3 == 5) { *out = rotate_left(a, 32 - (b & 31), 32); return true; }  // rorw
+        return false;
+    }
+
+    if (opcode == 0x13 && zbb) {                   // OP-IMM
+        if (f3 == 1 && imm == 0x600) { *out = count_leading_zeros(a); return true; }       // clz
+        if (f3 == 1 && imm == 0x601) { *out = count_trailing_zeros(a); return true; }      // ctz
+        if (f3 == 1 && imm == 0x602) { *out = count_ones(a); return true; }                // cpop
+        if (f3 == 1 && imm == 0x604) { *out = (uint64_t)(int64_t)(int8_t)a; return true; }  // sext.b
+        if (f3 == 1 && imm == 0x605) { *out = (uint64_t)(int64_t)(int16_t)a; return true; } // sext.h
+        if (f3 == 5 && (imm >> 6) == 0x18) { *out = rotate_left(a, 64 - (imm & 63), 64); return true; }  // rori
+        if (f3 == 5 && imm == 0x6b8) {             // rev8
+            uint64_t r = 0;
+            for (int i = 0; i < 8; ++i) r |= ((a >> (8 * i)) & 0xff) << (56 - 8 * i);
+            *out = r;
+            return true;
+        }
+        if (f3 == 5 && imm == 0x287) {             // orc.b
+            uint64_t r = 0;
+            for (int i = 0; i < 8; ++i) {
+                if ((a >> (8 * i)) & 0xff) r |= 0xffULL << (8 * i);
+            }
+            *out = r;
+            return true;
+        }
+        return false;
+    }
+
+    if (opcode == 0x1b) {                          // OP-IMM-32
+        if (zba && f3 == 1 && (imm >> 6) == 0x02) { *out = (a & 0xffffffffULL) << (imm & 63); return true; }  // slli.uw
+        if (zbb && f3 == 1 && imm == 0x600) { *out = count_leading_zeros(a & 0xffffffffULL) - 32; return true; }      // clzw
+        if (zbb && f3 == 1 && imm == 0x601) { *out = count_trailing_zeros(a | (1ULL << 32)); return true; }          // ctzw
+        if (zbb && f3 == 1 && imm == 0x602) { *out = count_ones(a & 0xffffffffULL); return true; }                   // cpopw
+        if (zbb && f3 == 5 && f7 == 0x30) { *out = rotate_left(a, 32 - (imm & 31), 32); return true; }               // roriw
+        return false;
+    }
+
+    return false;
+}
+
+// ---------------------------------------------------------------------
+// Trap entry
+// ---------------------------------------------------------------------
+bool emulate_trap(TrapFrame* tf) {
+    uint32_t insn;
+    int len;
+    if (!fetch(tf->epc, &insn, &len)) return false;
+
+    bool misaligned = tf->cause == CAUSE_LOAD_MISALIGNED || tf->cause == CAUSE_STORE_MISALIGNED;
+    if (misaligned) {
+        if (!(emu_enabled & EMU_MISALIGNED) || !emulate_access(tf, insn, len)) return false;
+    } else if (tf->cause == CAUSE_ILLEGAL_INSN && len == 4) {
+        uint64_t result;
+        uint64_t a = get_reg(tf, (insn >> 15) & 31);
+        uint64_t b = get_reg(tf, (insn >> 20) & 31);
+        if (!exec_bitmanip(insn, a, b, &result)) return false;
+        set_reg(tf, (insn >> 7) & 31, result);
+    } else {
+        return false;
+    }
+
+    tf->epc += len;
+
+    Process* p = scheduler_get_proc_by_pid(current);
+    if (p) {
+        if (misaligned) p->emu_misaligned++;
+        else p->emu_insns++;
+    }
+    return true;
+}
+
+// ---------------------------------------------------------------------
+// Shell commands (registered through EMULATE_COMMANDS)
+// ---------------------------------------------------------------------
+struct EmuOption {
+    const char* name;
+    uint32_t flag;
+};
+
+static const EmuOption emu_options[] = {
+    { "misaligned", EMU_MISALIGNED },
+    { "zba", EMU_ZBA },
+    { "zbb", EMU_ZBB },
+};
+
+static const int EMU_OPTION_COUNT = sizeof(emu_options) / sizeof(emu_options[0]);
+
+void cmd_emu(const char* args) {
+    if (args && args[0]) {
+        for (int i = 0; i < EMU_OPTION_COUNT; ++i) {
+            int n = strlen(emu_options[i].name);
+            if (strncmp(args, emu_options[i].name, n) != 0 || args[n] != ' ') continue;
+
+            const char* state = args + n + 1;
+            if (strcmp(state, "on") == 0) emu_enabled |= emu_options[i].flag;
+            else if (strcmp(state, "off") == 0) emu_enabled &= ~emu_options[i].flag;
+            else break;
+            return;
+        }
+        shell_fail("Usage: emu [misaligned|zba|zbb on|off]\n");
+        return;
+    }
+
+    print_str("Emulating:");
+    for (int i = 0; i < EMU_OPTION_COUNT; ++i) {
+        print_str(" ");
+        print_str(emu_options[i].name);
+        print_str((emu_enabled & emu_options[i].flag) ? " on" : " off");
+    }
+    print_str("\n");
+
+    print_str("PID\tName\t\tMisaligned\tInstructions\n");
+    print_str("---------------------------------------------------\n");
+
+    Process* table = scheduler_get_process_table();
+    int max = scheduler_get_max_procs();
+    for (int i = 0; i < max; ++i) {
+        Process* p = &table[i];
+        if (p->state == PROC_FREE) continue;
+
+        char buf[12];
+        itoa(p->pid, buf, 10);
+        print_str(buf);
+        print_str("\t");
+
+        const char* name = p->name ? p->name : "(no name)";
+        print_str(name);
+        print_str(strlen(name) < 8 ? "\t\t" : "\t");
+
+        itoa(p->emu_misaligned, buf, 10);
+        print_str(buf);
+        print_str("\t\t");
+        itoa(p->emu_insns, buf, 10);
+        print_str(buf);
+        print_str("\n");
+    }
+}
@@ -0,0 +1,26 @@
+/* Copyright (c) 2025, Rye Stahle-Smith
+December 2nd, 2025 - emulate.h
+Description: Trap-time emulation of misaligned loads/stores and of Zba/Zbb instructions the hart lacks, with per-process counters. */
+#ifndef EMULATE_H
+#define EMULATE_H
+
+#pragma once
+#include <stdint.h>
+#include "scheduler.h"
+
+// What the trap handler may emulate (each can be switched off with `emu`)
+#define EMU_MISALIGNED 0x1  // misaligned integer loads and stores
+#define EMU_ZBA        0x2  // sh1add..sh3add, add.uw, shNadd.uw, slli.uw
+#define EMU_ZBB        0x4  // andn/orn/xnor, min/max, clz/ctz/cpop, sext/zext, rotates, rev8, orc.b
+
+// Try to carry out the instruction that raised the exception in tf (a
+// complete frame) on the saved registers. On success the frame holds the
+// result, epc is past the instruction and the current process's counter is
+// charged; otherwise nothing is changed and the trap is a real fault.
+bool emulate_trap(TrapFrame* tf);
+
+// Shell commands provided by the emulator (see commands.h)
+#define EMULATE_COMMANDS(CMD) \
+    CMD("emu", cmd_emu, "'emu [ext on|off]'\tShow emulated traps per process, or toggle misaligned/zba/zbb.")
+
+#endif
@@ -3,23 +3,66 @@ December 2nd, 2025 - fat.cpp
 Description: In-memory FAT-like filesystem implementation supporting directories, files, path traversal, CRUD operations, and resource reporting. */
 #include "shell.h"
 #include "fat.h"
+#include "timer.h"
 
 // Constructor initializes root and pools
 FAT::FAT() {
     // mark all pool objects as free
-    for (int i = 0; i < MAX_DIRS; i++) dir_pool[i].used = false;
-    for (int i = 0; i < MAX_FILES; i++) file_pool[i].used = false;
+    dir_pool.init();
+    file_pool.init();
+    for (int i = 0; i < MAX_INODES; i++) inode_pool[i].used = false;
+    for (int i = 0; i < MAX_OPEN_FILES; i++) open_pool[i].used = false;
+    readahead_hook = nullptr;
 
     // init root
     strcpy(root.name, "/");
     root.parent = nullptr;
     root.subdir_count = 0;
     root.file_count = 0;
-    root.used = true;
+
+    // empty journal, nothing committed yet
+    journal_count = 0;
+    journal_seq = 1;
+    journal_commit_count = 0;
+    journal_sink = nullptr;
 }
 
 Directory* FAT::get_root() { return &root; }
 
+// Current time in timer ticks, used for inode timestamps
+static uint64_t fs_now() {
+    return timer_now();
+}
+
+// Grab a free inode with a single link
+Inode* FAT::alloc_inode() {
+    for (int i = 0; i < MAX_INODES; i++) {
+        if (!inode_pool[i].used) {
+            Inode* ino = &inode_pool[i];
+            ino->used = true;
+            ino->size = 0;
+            ino->mode = MODE_DEFAULT;
+            ino->nlink = 1;
+            ino->open_count = 0;
+            ino->mtime = ino->ctime = fs_now();
+            return ino;
+        }
+    }
+    return nullptr;
+}
+
+// Drop one link; the inode is freed once no entry or handle references it
+void FAT::put_inode(Inode* inode) {
+    if (inode->nlink > 0) inode->nlink--;
+    inode->ctime = fs_now();
+    if (inode->nlink == 0 && inode->open_count == 0) inode->used = false;
+}
+
+// Record a content change
+void FAT::mark_modified(Inode* inode) {
+    inode->mtime = inode->ctime = fs_now();
+}
+
 Directory* FAT::find_subdir_recursive(Directory* start, const char* path) {
     if (!start || !path || !*path) return start;
 
@@ -54,6 +97,24 @@ File* FAT::find_file(Directory* dir, const char* name) {
     return nullptr;
 }
 
+// Resolve "dir/.../name" (absolute or relative to start) to a file
+// Directory that would hold the last component of path, which is copied out
+Directory* FAT::resolve_parent(Directory* start, const char* path, char* out_name) {
+    if (!path || !*path) return nullptr;
+    if (path[0] == '/') {
+        start = &root;
+        while (*path == '/') path++;
+    }
+    return touch_recursive(start, path, out_name);
+}
+
+File* FAT::resolve_file(Directory* start, const char* path) {
+    char name[32];
+    Directory* parent = resolve_parent(start, path, name);
+    if (!parent) return nullptr;
+    return find_file(parent, name);
+}
+
 static bool is_name_invalid(const char* name) {
     if (!name || !name[0]) return true;        // empty or null
 
@@ -110,20 +171,20 @@ Directory* FAT::mkdir(Directory* dir, const char* name) {
     if (dir->subdir_count >= MAX_DIRS) return nullptr;
     if (find_subdir(dir, name)) return nullptr;
 
-    // find free directory in pool
-    for (int i = 0; i < MAX_DIRS; i++) {
-        if (!dir_pool[i].used) {
-            Directory* new_dir = &dir_pool[i];
-            new_dir->used = true;
-            strcpy(new_dir->name, name);
-            new_dir->parent = dir;
-            new_dir->subdir_count = 0;
-            new_dir->file_count = 0;
-            dir->subdirs[dir->subdir_count++] = new_dir;
-            return new_dir;
-        }
+    Directory* new_dir = dir_pool.alloc();
+    if (!new_dir) return nullptr; // no free directories
+
+    if (!journal_log(JOURNAL_MKDIR, dir, name)) {
+        dir_pool.free(new_dir);
+        return nullptr;
     }
-    return nullptr; // no free directories
+
+    strcpy(new_dir->name, name);
+    new_dir->parent = dir;
+    new_dir->subdir_count = 0;
+    new_dir->file_count = 0;
+    dir->subdirs[dir->subdir_count++] = new_dir;
+    return new_dir;
 }
 
 // rmdir
@@ -132,7 +193,8 @@ bool FAT::rmdir(Directory* dir, const char* name) {
         Directory* sub = dir->subdirs[i];
         if (strcmp(sub->name, name) == 0) {
             if (sub->subdir_count > 0 || sub->file_count > 0) return false; // not empty
-            sub->used = false;
+            if (!journal_log(JOURNAL_RMDIR, dir, name)) return false;
+            dir_pool.free(sub);
             for (int j = i; j < dir->subdir_count - 1; j++) dir->subdirs[j] = dir->subdirs[j+1];
             dir->subdir_count--;
             return true;
@@ -188,39 +250,97 @@ File* FAT::touch(Directory* dir, const char* name) {
     if (dir->file_count >= MAX_FILES) return nullptr;
     if (find_file(dir, name)) return nullptr;
 
-    for (int i = 0; i < MAX_FILES; i++) {
-        if (!file_pool[i].used) {
-            File* f = &file_pool[i];
-            f->used = true;
-            strcpy(f->name, name);
-            f->size = 0;
-            dir->files[dir->file_count++] = f;
-            return f;
-        }
+    File* f = file_pool.alloc();
+    if (!f) return nullptr;
+
+    Inode* ino = alloc_inode();
+    if (!ino) {
+        file_pool.free(f);
+        return nullptr; // no free inodes
     }
-    return nullptr;
+
+    if (!journal_log(JOURNAL_TOUCH, dir, name)) {
+        ino->used = false;
+        file_pool.free(f);
+        return nullptr;
+    }
+
+    strcpy(f->name, name);
+    f->inode = ino;
+    dir->files[dir->file_count++] = f;
+    return f;
+}
+
+// Drop entry i from a directory's file list without freeing the file
+static void unlink_file(Directory* dir, int i) {
+    for (int j = i; j < dir->file_count - 1; j++) dir->files[j] = dir->files[j+1];
+    dir->file_count--;
 }
 
 // rm
 bool FAT::rm(Directory* dir, const char* name) {
     for (int i = 0; i < dir->file_count; i++) {
         if (strcmp(dir->files[i]->name, name) == 0) {
-            dir->files[i]->used = false;
-            for (int j = i; j < dir->file_count - 1; j++) dir->files[j] = dir->files[j+1];
-            dir->file_count--;
+            if (!journal_log(JOURNAL_RM, dir, name)) return false;
+            File* f = dir->files[i];
+            put_inode(f->inode);
+            file_pool.free(f);
+            unlink_file(dir, i);
             return true;
         }
     }
     return false;
 }
 
-// mv
+// mv: link into the destination before unlinking from the source, so the
+// file is reachable from at least one directory at every point
 bool FAT::mv(Directory* src_dir, const char* name, Directory* dest_dir) {
     File* f = find_file(src_dir, name);
     if (!f || dest_dir->file_count >= MAX_FILES) return false;
+    if (src_dir == dest_dir || find_file(dest_dir, name)) return false;
 
-    rm(src_dir, name);
+    if (!journal_log(JOURNAL_MV, src_dir, name, dest_dir)) return false;
     dest_dir->files[dest_dir->file_count++] = f;
+
+    for (int i = 0; i < src_dir->file_count; i++) {
+        if (src_dir->files[i] == f) {
+            unlink_file(src_dir, i);
+            break;
+        }
+    }
+    return true;
+}
+
+// link: a second directory entry for the same inode
+bool FAT::link(Directory* src_dir, const char* name, Directory* dest_dir, const char* new_name) {
+    File* f = find_file(src_dir, name);
+    if (!f || is_name_invalid(new_name) || strlen(new_name) >= MAX_NAME_LEN) return false;
+    if (dest_dir->file_count >= MAX_FILES || find_file(dest_dir, new_name)) return false;
+
+    File* entry = file_pool.alloc();
+    if (!entry) return false; // no free directory entries
+
+    if (!journal_log(JOURNAL_LINK, src_dir, name, dest_dir, new_name)) {
+        file_pool.free(entry);
+        return false;
+    }
+
+    strcpy(entry->name, new_name);
+    entry->inode = f->inode;
+    f->inode->nlink++;
+    f->inode->ctime = fs_now();
+    dest_dir->files[dest_dir->file_count++] = entry;
+    return true;
+}
+
+// chmod: replace the permission bits
+bool FAT::chmod(Directory* dir, const char* name, uint16_t mode) {
+    File* f = find_file(dir, name);
+    if (!f || mode > (MODE_READ | MODE_WRITE | MODE_EXEC)) return false;
+    if (!journal_log(JOURNAL_CHMOD, dir, name, nullptr, nullptr, mode)) return false;
+
+    f->inode->mode = mode;
+    f->inode->ctime = fs_now();
     return true;
 }
 
@@ -252,31 +372,436 @@ void FAT::ls(Directory* cwd, const char* path) {
     }
 }
 
-// Returns the number of used directories in the pool
-int FAT::count_used_dirs() const {
-    int cnt = 0;
-    for (int i = 0; i < MAX_DIRS; i++) if (dir_pool[i].used) cnt++;
-    return cnt;
+// ---------------------------------------------------------------------
+// Tree operations
+// Walks keep an explicit frame per directory level instead of recursing,
+// so kernel stack use is fixed no matter how deep the tree is.
+// ---------------------------------------------------------------------
+
+// Append "/name" (or just "name" at the root of a walk); returns new length
+static int path_push(char* path, int len, const char* name) {
+    if (len > 0 && len < MAX_PATH_LEN - 1) path[len++] = '/';
+    for (int i = 0; name[i] && len < MAX_PATH_LEN - 1; i++) path[len++] = name[i];
+    path[len] = '\0';
+    return len;
 }
 
-// Returns the number of free directories
-int FAT::count_free_dirs() const { return MAX_DIRS - count_used_dirs(); }
+// Report a directory and the files directly inside it
+static bool walk_visit(Directory* dir, char* path, int len, WalkFn fn, void* ctx) {
+    if (!fn(WALK_ENTER, dir, nullptr, path, ctx)) return false;
 
-// Returns the number of used files in the pool
-int FAT::count_used_files() const {
+    for (int i = 0; i < dir->file_count; i++) {
+        path_push(path, len, dir->files[i]->name);
+        bool more = fn(WALK_FILE, dir, dir->files[i], path, ctx);
+        path[len] = '\0';
+        if (!more) return false;
+    }
+    return true;
+}
+
+bool FAT::walk(Directory* start, WalkFn fn, void* ctx) {
+    struct Frame { Directory* dir; int next; int path_len; };
+    Frame stack[MAX_DIRS + 1];   // root plus every pooled directory
+    char path[MAX_PATH_LEN];
+    int depth = 0;
+
+    path[0] = '\0';
+    stack[0].dir = start;
+    stack[0].next = 0;
+    stack[0].path_len = 0;
+    if (!walk_visit(start, path, 0, fn, ctx)) return false;
+
+    while (depth >= 0) {
+        Frame* fr = &stack[depth];
+
+        if (fr->next < fr->dir->subdir_count && depth < MAX_DIRS) {
+            Directory* sub = fr->dir->subdirs[fr->next++];
+            int len = path_push(path, fr->path_len, sub->name);
+
+            depth++;
+            stack[depth].dir = sub;
+            stack[depth].next = 0;
+            stack[depth].path_len = len;
+            if (!walk_visit(sub, path, len, fn, ctx)) return false;
+        } else {
+            path[fr->path_len] = '\0';
+            if (!fn(WALK_LEAVE, fr->dir, nullptr, path, ctx)) return false;
+            depth--;
+            if (depth >= 0) path[stack[depth].path_len] = '\0';
+        }
+    }
+    return true;
+}
+
+// True if dir is ancestor itself or lies somewhere below it
+bool FAT::contains(Directory* ancestor, Directory* dir) const {
+    for (Directory* d = dir; d; d = d->parent) {
+        if (d == ancestor) return true;
+    }
+    return false;
+}
+
+// rm -r: repeatedly strip the deepest last subdirectory until only the
+// target is left, so no recursion and no walker frames are needed
+bool FAT::rm_tree(Directory* dir, const char* name) {
+    Directory* target = find_subdir(dir, name);
+    if (!target) return false;
+
+    while (true) {
+        Directory* leaf = target;
+        while (leaf->subdir_count > 0) leaf = leaf->subdirs[leaf->subdir_count - 1];
+
+        // rm/rmdir fail without changing anything (e.g. the journal cannot
+        // commit), so stop at the first failure instead of retrying forever
+        while (leaf->file_count > 0)
+            if (!rm(leaf, leaf->files[leaf->file_count - 1]->name)) return false;
+        if (leaf == target) break;
+        if (!rmdir(leaf->parent, leaf->name)) return false;
+    }
+    return rmdir(dir, name);
+}
+
+// cp: new inode with the same contents and mode. Inode data is stored
+// inline, so there are no extents to share and the bytes are copied.
+File* FAT::cp(File* src, Directory* dest_dir, const char* name) {
+    if (!src) return nullptr;
+
+    File* f = touch(dest_dir, name);
+    if (!f) return nullptr;
+
+    memcpy(f->inode->data, src->inode->data, src->inode->size);
+    f->inode->size = src->inode->size;
+    f->inode->mode = src->inode->mode;
+    mark_modified(f->inode);
+    return f;
+}
+
+// cp -r state: destination directory for each level of the source walk
+struct CopyCtx {
+    FAT* fs;
+    Directory* src_root;
+    Directory* dest_root;
+    const char* name;
+    Directory* dest[MAX_DIRS + 1];
+    int top;
+};
+
+static bool copy_visit(WalkEvent ev, Directory* dir, File* f, const char* path, void* ctx) {
+    (void)path;
+    CopyCtx* c = (CopyCtx*)ctx;
+
+    if (ev == WALK_ENTER) {
+        Directory* parent = (dir == c->src_root) ? c->dest_root : c->dest[c->top];
+        Directory* made = c->fs->mkdir(parent, (dir == c->src_root) ? c->name : dir->name);
+        if (!made) return false;
+        c->dest[++c->top] = made;
+    } else if (ev == WALK_FILE) {
+        if (!c->fs->cp(f, c->dest[c->top], f->name)) return false;
+    } else {
+        c->top--;
+    }
+    return true;
+}
+
+Directory* FAT::cp_tree(Directory* src, Directory* dest_dir, const char* name) {
+    // copying a tree into itself would keep walking the fresh copies
+    if (!src || !dest_dir || contains(src, dest_dir)) return nullptr;
+
+    CopyCtx c;
+    c.fs = this;
+    c.src_root = src;
+    c.dest_root = dest_dir;
+    c.name = name;
+    c.top = -1;
+
+    if (!walk(src, copy_visit, &c)) return nullptr;
+    return find_subdir(dest_dir, name);
+}
+
+struct DuCtx { uint32_t bytes; int files; };
+
+static bool du_visit(WalkEvent ev, Directory* dir, File* f, const char* path, void* ctx) {
+    (void)dir; (void)path;
+    if (ev == WALK_FILE) {
+        DuCtx* d = (DuCtx*)ctx;
+        d->bytes += f->inode->size;
+        d->files++;
+    }
+    return true;
+}
+
+// du: total content bytes (and file count) below a directory
+uint32_t FAT::du(Directory* dir, int* file_count) {
+    DuCtx d = { 0, 0 };
+    walk(dir, du_visit, &d);
+    if (file_count) *file_count = d.files;
+    return d.bytes;
+}
+
+// Shell-style wildcard match ('*' and '?'), backtracking to the last '*'
+static bool glob_match(const char* pat, const char* name) {
+    const char* star = nullptr;
+    const char* resume = nullptr;
+
+    while (*name) {
+        if (*pat == '?' || *pat == *name) {
+            pat++;
+            name++;
+        } else if (*pat == '*') {
+            star = pat++;
+            resume = name;
+        } else if (star) {
+            pat = star + 1;
+            name = ++resume;
+        } else {
+            return false;
+        }
+    }
+    while (*pat == '*') pat++;
+    return *pat == '\0';
+}
+
+struct FindCtx { const char* pattern; const char* prefix; int matches; };
+
+static bool find_visit(WalkEvent ev, Directory* dir, File* f, const char* path, void* ctx) {
+    FindCtx* c = (FindCtx*)ctx;
+    const char* name = nullptr;
+
+    if (ev == WALK_FILE) name = f->name;
+    else if (ev == WALK_ENTER && path[0]) name = dir->name;
+    if (!name || !glob_match(c->pattern, name)) return true;
+
+    print_str(c->prefix);
+    print_str(path);
+    if (ev == WALK_ENTER) print_str("/");
+    print_str("\n");
+    c->matches++;
+    return true;
+}
+
+// find: print every entry below start whose name matches the pattern
+int FAT::find(Directory* start, const char* pattern, const char* prefix) {
+    FindCtx c = { pattern, prefix ? prefix : "", 0 };
+    walk(start, find_visit, &c);
+    return c.matches;
+}
+
+// Pool counters: O(1), no scan
+int FAT::count_used_dirs() const { return dir_pool.used(); }
+int FAT::count_free_dirs() const { return dir_pool.available(); }
+int FAT::count_used_files() const { return file_pool.used(); }
+int FAT::count_free_files() const { return file_pool.available(); }
+
+// Returns the number of allocated inodes (hard links share one)
+int FAT::count_used_inodes() const {
     int cnt = 0;
-    for (int i = 0; i < MAX_FILES; i++) if (file_pool[i].used) cnt++;
+    for (int i = 0; i < MAX_INODES; i++) if (inode_pool[i].used) cnt++;
     return cnt;
 }
 
-// Returns the number of free files
-int FAT::count_free_files() const { return MAX_FILES - count_used_files(); }
-
 // Returns total bytes used by all files
 uint32_t FAT::total_file_bytes() const {
     uint32_t total = 0;
-    for (int i = 0; i < MAX_FILES; i++) {
-        if (file_pool[i].used) total += file_pool[i].size;
+    for (int i = 0; i < MAX_INODES; i++) {
+        if (inode_pool[i].used) total += inode_pool[i].size;
     }
     return total;
 }
+
+// ---------------------------------------------------------------------
+// Metadata journal
+// Every namespace change is appended here before it is applied. Records
+// accumulate and are handed to the sink in one batch (group commit) when
+// the buffer fills or on an explicit sync, instead of one write per op.
+// ---------------------------------------------------------------------
+
+// Pool index of a directory, or -1 for root
+int FAT::dir_index(Directory* dir) const {
+    if (!dir || dir == &root) return -1;
+    return dir_pool.index_of(dir);
+}
+
+bool FAT::journal_log(JournalOp op, Directory* dir, const char* name, Directory* dest,
+                      const char* new_name, uint16_t arg) {
+    if (journal_count >= JOURNAL_MAX_RECORDS && !sync()) return false;
+
+    JournalRecord* r = &journal[journal_count];
+    r->seq = journal_seq++;
+    r->op = op;
+    r->dir = (int8_t)dir_index(dir);
+    r->dest = (int8_t)(dest ? dir_index(dest) : -1);
+    r->arg = arg;
+    strncpy(r->name, name, MAX_NAME_LEN - 1);
+    r->name[MAX_NAME_LEN - 1] = '\0';
+    strncpy(r->new_name, new_name ? new_name : "", MAX_NAME_LEN - 1);
+    r->new_name[MAX_NAME_LEN - 1] = '\0';
+    journal_count++;
+    return true;
+}
+
+// Commit all pending records as a single batch
+bool FAT::sync() {
+    if (journal_count == 0) return true;
+
+    uint32_t commit_seq = journal[journal_count - 1].seq;
+    if (journal_sink && !journal_sink(journal, journal_count, commit_seq)) {
+        print_str("(fat) Journal commit failed\n");
+        return false;
+    }
+
+    journal_count = 0;
+    journal_commit_count++;
+    return true;
+}
+
+void FAT::set_journal_sink(JournalSink sink) { journal_sink = sink; }
+
+// Returns the number of records waiting for the next commit
+int FAT::journal_pending() const { return journal_count; }
+
+// Returns the number of group commits performed so far
+uint32_t FAT::journal_commits() const { return journal_commit_count; }
+
+// ---------------------------------------------------------------------
+// Open files and readahead
+// A read that starts where the previous one ended is sequential. Sequential
+// readers get a readahead window that doubles each time the reader crosses
+// its midpoint, so the next window is requested before it is needed; any
+// seek or random read collapses the window back to READAHEAD_MIN.
+// ---------------------------------------------------------------------
+OpenFile* FAT::open(File* f) {
+    if (!f || !(f->inode->mode & MODE_READ)) return nullptr;
+
+    for (int i = 0; i < MAX_OPEN_FILES; i++) {
+        if (!open_pool[i].used) {
+            OpenFile* of = &open_pool[i];
+            of->used = true;
+            of->inode = f->inode;
+            f->inode->open_count++;
+            of->offset = 0;
+            of->last_end = 0;
+            of->ra_start = 0;
+            of->ra_size = 0;
+            of->refs = 1;
+            return of;
+        }
+    }
+    return nullptr; // no free handles
+}
+
+int FAT::read(OpenFile* of, void* buf, int len) {
+    if (!of || !of->used || !buf || len < 0) return -1;
+
+    Inode* f = of->inode;
+    if (of->offset >= f->size) return 0;
+    if (len > f->size - of->offset) len = f->size - of->offset;
+
+    if (of->offset != of->last_end || of->ra_size == 0) {
+        // random access (or first read): restart with the minimum window
+        of->ra_start = of->offset;
+        of->ra_size = READAHEAD_MIN;
+        readahead(of, of->ra_start, of->ra_size);
+    } else if (of->offset + len > of->ra_start + of->ra_size / 2) {
+        // sequential and past the midpoint: grow and issue the next window,
+        // never behind what this read is about to consume
+        int next = of->ra_start + of->ra_size;
+        of->ra_start = next > of->offset + len ? next : of->offset + len;
+        if (of->ra_size < READAHEAD_MAX) of->ra_size *= 2;
+        readahead(of, of->ra_start, of->ra_size);
+    }
+
+    memcpy(buf, f->data + of->offset, len);
+    of->offset += len;
+    of->last_end = of->offset;
+    return len;
+}
+
+bool FAT::seek(OpenFile* of, int offset) {
+    if (!of || !of->used || offset < 0 || offset > of->inode->size) return false;
+    of->offset = offset;
+    return true;
+}
+
+// Share a handle (and its offset) with another descriptor
+OpenFile* FAT::dup(OpenFile* of) {
+    if (!of || !of->used) return nullptr;
+    of->refs++;
+    return of;
+}
+
+void FAT::close(OpenFile* of) {
+    if (!of || !of->used) return;
+    if (--of->refs > 0) return;
+    of->used = false;
+
+    // last handle on an unlinked inode releases it
+    Inode* ino = of->inode;
+    if (ino->open_count > 0) ino->open_count--;
+    if (ino->nlink == 0 && ino->open_count == 0) ino->used = false;
+}
+
+void FAT::set_readahead_hook(ReadaheadHook hook) { readahead_hook = hook; }
+
+// Request a window from the backing store; data already resident in the
+// in-memory pool needs no fetch, so without a hook this is free
+void FAT::readahead(OpenFile* of, int start, int len) {
+    if (start >= of->inode->size) return;
+    if (len > of->inode->size - start) len = of->inode->size - start;
+    if (readahead_hook) readahead_hook(of->inode, start, len);
+}
+
+// ---------------------------------------------------------------------
+// Shell commands (registered through FAT_COMMANDS)
+// ---------------------------------------------------------------------
+void cmd_df(const char* args) {
+    (void)args;
+    char buf[32];
+
+    int used_dirs = fat.count_used_dirs();
+    int free_dirs = fat.count_free_dirs();
+    int used_files = fat.count_used_files();
+    int free_files = fat.count_free_files();
+    uint32_t total_bytes = fat.total_file_bytes();
+
+    print_str("Resource\tUsed\tFree\tMax\n");
+    print_str("-------------------------------------\n");
+
+    itoa(used_dirs, buf, 10);
+    print_str("Directories\t"); print_str(buf); print_str("\t");
+    itoa(free_dirs, buf, 10);
+    print_str(buf); print_str("\t");
+    itoa(MAX_DIRS, buf, 10);
+    print_str(buf); print_str("\n");
+
+    itoa(used_files, buf, 10);
+    print_str("Files\t\t"); print_str(buf); print_str("\t");
+    itoa(free_files, buf, 10);
+    print_str(buf); print_str("\t");
+    itoa(used_files + free_files, buf, 10);  // the entry pool can grow
+    print_str(buf); print_str("\n");
+
+    int used_inodes = fat.count_used_inodes();
+    itoa(used_inodes, buf, 10);
+    print_str("Inodes\t\t"); print_str(buf); print_str("\t");
+    itoa(MAX_INODES - used_inodes, buf, 10);
+    print_str(buf); print_str("\t");
+    itoa(MAX_INODES, buf, 10);
+    print_str(buf); print_str("\n\n");
+
+    itoa(total_bytes / 1024, buf, 10);
+    print_str("Used Space: "); print_str(buf); print_str(" KB\n");
+
+    itoa((MAX_FILES * MAX_FILE_SIZE) / 1024, buf, 10);
+    print_str("Total Space: "); print_str(buf); print_str(" MB\n");
+
+    itoa(fat.journal_pending(), buf, 10);
+    print_str("Journal: "); print_str(buf); print_str(" pending, ");
+    itoa(fat.journal_commits(), buf, 10);
+    print_str(buf); print_str(" commits\n");
+}
+
+void cmd_sync(const char* args) {
+    (void)args;
+    if (fat.sync()) print_str("Metadata journal committed.\n");
+    else shell_fail("Sync failed.\n");
+}
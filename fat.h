@@ -6,19 +6,43 @@ Description: Definitions for FAT-style filesystem structures, limits, and public
 
 #pragma once
 #include <stdint.h>
+#include "pool.h"
 
 constexpr int MAX_NAME_LEN = 16;
 constexpr int MAX_FILES = 64;
+constexpr int MAX_INODES = MAX_FILES;
 constexpr int MAX_DIRS = 16;
 constexpr int MAX_FILE_SIZE = 16384;  // ~16 KB
+constexpr int JOURNAL_MAX_RECORDS = 32;  // records batched per group commit
+constexpr int MAX_PATH_LEN = MAX_DIRS * MAX_NAME_LEN;
+constexpr int MAX_OPEN_FILES = 32;
+constexpr int READAHEAD_MIN = 256;    // initial readahead window (bytes)
+constexpr int READAHEAD_MAX = 4096;   // window cap once streaming
 
-struct File {
-    char name[MAX_NAME_LEN];
+// Permission bits (owner only, octal like Unix)
+constexpr uint16_t MODE_READ = 04;
+constexpr uint16_t MODE_WRITE = 02;
+constexpr uint16_t MODE_EXEC = 01;
+constexpr uint16_t MODE_DEFAULT = MODE_READ | MODE_WRITE;
+
+// File contents and metadata, shared by every directory entry linking to it
+struct Inode {
     uint8_t data[MAX_FILE_SIZE];
     int size;
+    uint16_t mode;
+    uint16_t nlink;       // directory entries pointing here
+    uint16_t open_count;  // open handles keeping it alive after unlink
+    uint64_t mtime;       // rdtime ticks at last content change
+    uint64_t ctime;       // rdtime ticks at last metadata change
     bool used;
 };
 
+// Directory entry: a name bound to an inode
+struct File {
+    char name[MAX_NAME_LEN];
+    Inode* inode;
+};
+
 struct Directory {
     char name[MAX_NAME_LEN];
     Directory* parent;
@@ -26,9 +50,58 @@ struct Directory {
     int subdir_count;
     File* files[MAX_FILES];
     int file_count;
+};
+
+// Open-file handle with per-handle sequential access detection
+struct OpenFile {
+    Inode* inode;
+    int offset;     // next read position
+    int last_end;   // where the previous read finished
+    int ra_start;   // start of the current readahead window
+    int ra_size;    // current window size; grows while access stays sequential
+    int refs;       // descriptors sharing this handle (dup2)
     bool used;
 };
 
+// Events reported by FAT::walk
+enum WalkEvent {
+    WALK_ENTER,  // before a directory's files and subdirectories
+    WALK_FILE,
+    WALK_LEAVE   // after everything below the directory
+};
+
+// Tree walk callback; path is relative to the walk root. Return false to stop.
+typedef bool (*WalkFn)(WalkEvent ev, Directory* dir, File* f, const char* path, void* ctx);
+
+// Metadata operations recorded in the write-ahead journal
+enum JournalOp : uint8_t {
+    JOURNAL_MKDIR,
+    JOURNAL_RMDIR,
+    JOURNAL_TOUCH,
+    JOURNAL_RM,
+    JOURNAL_MV,
+    JOURNAL_LINK,
+    JOURNAL_CHMOD
+};
+
+// One logged metadata update. Directories are named by pool index (-1 = root)
+// so the log can be replayed without relying on in-memory pointers.
+struct JournalRecord {
+    uint32_t seq;
+    JournalOp op;
+    int8_t dir;
+    int8_t dest;
+    uint16_t arg;               // new mode for JOURNAL_CHMOD
+    char name[MAX_NAME_LEN];
+    char new_name[MAX_NAME_LEN]; // link name for JOURNAL_LINK
+};
+
+// Persists one committed batch of records; returns false if the write failed
+typedef bool (*JournalSink)(const JournalRecord* records, int count, uint32_t commit_seq);
+
+// Asked to start fetching [offset, offset + len) of a file ahead of the reader
+typedef void (*ReadaheadHook)(Inode* inode, int offset, int len);
+
 class FAT {
 public:
     FAT();
@@ -41,26 +114,84 @@ public:
     Directory* touch_recursive(Directory* start, const char* path, char* out_name);
     bool rm(Directory* dir, const char* name);
     bool mv(Directory* src_dir, const char* name, Directory* dest_dir);
+    bool link(Directory* src_dir, const char* name, Directory* dest_dir, const char* new_name);
+    bool chmod(Directory* dir, const char* name, uint16_t mode);
+    void mark_modified(Inode* inode);
     void ls(Directory* dir, const char* path = nullptr);
 
+    // tree operations (iterative, stack depth bounded by MAX_DIRS)
+    bool walk(Directory* start, WalkFn fn, void* ctx);
+    bool contains(Directory* ancestor, Directory* dir) const;
+    bool rm_tree(Directory* dir, const char* name);
+    File* cp(File* src, Directory* dest_dir, const char* name);
+    Directory* cp_tree(Directory* src, Directory* dest_dir, const char* name);
+    uint32_t du(Directory* dir, int* file_count);
+    int find(Directory* start, const char* pattern, const char* prefix);
+
     // helper find functions
     Directory* find_subdir_recursive(Directory* start, const char* path);
     Directory* find_subdir(Directory* dir, const char* name);
     File* find_file(Directory* dir, const char* name);
+    File* resolve_file(Directory* start, const char* path);
+    Directory* resolve_parent(Directory* start, const char* path, char* out_name);  // out_name: 32 bytes
+
+    // open-file handles
+    OpenFile* open(File* f);
+    int read(OpenFile* of, void* buf, int len);
+    bool seek(OpenFile* of, int offset);
+    OpenFile* dup(OpenFile* of);
+    void close(OpenFile* of);
+    void set_readahead_hook(ReadaheadHook hook);
 
     int count_used_dirs() const;
     int count_free_dirs() const;
     int count_used_files() const;
     int count_free_files() const;
+    int count_used_inodes() const;
     uint32_t total_file_bytes() const;
 
+    // metadata journal (group commit)
+    bool sync();
+    void set_journal_sink(JournalSink sink);
+    int journal_pending() const;
+    uint32_t journal_commits() const;
+
 private:
     Directory root;
 
-    // object pools
-    Directory dir_pool[MAX_DIRS];
-    File file_pool[MAX_FILES];
+    // write-ahead journal
+    JournalRecord journal[JOURNAL_MAX_RECORDS];
+    int journal_count;
+    uint32_t journal_seq;
+    uint32_t journal_commit_count;
+    JournalSink journal_sink;
+
+    int dir_index(Directory* dir) const;
+    // False if the journal is full and could not be committed: the caller
+    // must fail without changing anything
+    bool journal_log(JournalOp op, Directory* dir, const char* name, Directory* dest = nullptr,
+                     const char* new_name = nullptr, uint16_t arg = 0);
+
+    Inode* alloc_inode();
+    void put_inode(Inode* inode);
+
+    // open-file table
+    OpenFile open_pool[MAX_OPEN_FILES];
+    ReadaheadHook readahead_hook;
+
+    void readahead(OpenFile* of, int start, int len);
+
+    // object pools. Directories are fixed (the journal names them by pool
+    // index); directory entries grow past MAX_FILES on demand.
+    ObjectPool<Directory, MAX_DIRS> dir_pool;
+    ObjectPool<File, MAX_FILES, true> file_pool;
+    Inode inode_pool[MAX_INODES];
 };
 extern FAT fat;
 
+// Shell commands provided by the filesystem (see commands.h)
+#define FAT_COMMANDS(CMD) \
+    CMD("df", cmd_df, "'df'\t\tDisplay current storage and resources.") \
+    CMD("sync", cmd_sync, "'sync'\t\tCommit pending filesystem metadata.")
+
 #endif
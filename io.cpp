@@ -0,0 +1,198 @@
+/* Copyright (c) 2025, Rye Stahle-Smith
+December 2nd, 2025 - io.cpp
+Description: Asynchronous I/O layer with a shared submission queue, multiple in-flight requests, completion wakeups, and batch submission for user programs. */
+#include "io.h"
+#include "scheduler.h"
+#include "shell.h"
+#include "fat.h"
+
+// Request slots and the submission ring feeding the device
+static IoRequest io_table[IO_QUEUE_DEPTH];
+static IoRequest* sq[IO_QUEUE_DEPTH];
+static int sq_head = 0;
+static int sq_tail = 0;
+static int sq_count = 0;
+
+static IoStartFn device_start = nullptr;
+
+// Processes blocked in io_wait
+static WaitQueue io_waiters;
+
+// ---------------------------------------------------------------------
+// Default device: the in-memory file pool
+// Requests are started from io_service() rather than from the submitting
+// process, so submitters observe the same asynchronous completion they
+// would get from a real disk.
+// ---------------------------------------------------------------------
+static void memory_device_start(IoRequest* req) {
+    int64_t result = 0;
+
+    if (req->op == IO_READ) {
+        Inode* f = req->file->inode;
+        int len = req->len;
+        if (req->offset >= f->size) len = 0;
+        else if (len > f->size - req->offset) len = f->size - req->offset;
+
+        memcpy(req->buf, f->data + req->offset, len);
+        result = len;
+    }
+
+    io_complete(req, result);
+}
+
+// ---------------------------------------------------------------------
+// Public API
+// ---------------------------------------------------------------------
+void io_init() {
+    for (int i = 0; i < IO_QUEUE_DEPTH; ++i) {
+        io_table[i].status = IO_FREE;
+        io_table[i].owner_pid = 0;
+    }
+    sq_head = sq_tail = sq_count = 0;
+    device_start = memory_device_start;
+    wait_queue_init(&io_waiters);
+}
+
+void io_set_device(IoStartFn start) {
+    device_start = start ? start : memory_device_start;
+}
+
+bool io_submit(const IoSqe* sqe, int pid) {
+    Process* p = scheduler_get_leader(pid);  // owner of the descriptor table
+    if (!p || !sqe || sq_count >= IO_QUEUE_DEPTH) return false;
+    if (sqe->op != IO_NOP && sqe->op != IO_READ) return false;
+
+    OpenFile* of = nullptr;
+    if (sqe->op == IO_READ) {
+        if (sqe->fd < 0 || sqe->fd >= MAX_FDS || p->fds[sqe->fd].kind != FD_FILE) return false;
+        if (sqe->offset < 0 || sqe->len < 0) return false;
+        of = p->fds[sqe->fd].file;
+    }
+
+    for (int i = 0; i < IO_QUEUE_DEPTH; ++i) {
+        IoRequest* req = &io_table[i];
+        if (req->status != IO_FREE) continue;
+
+        // The request holds its own reference, so closing the descriptor
+        // (or exiting) before it runs cannot free the handle under it
+        req->op = (IoOp)sqe->op;
+        req->file = fat.dup(of);
+        req->offset = sqe->offset;
+        req->len = sqe->len;
+        req->buf = (uint8_t*)sqe->buf;
+        req->user_data = sqe->user_data;
+        req->result = 0;
+        req->owner_pid = pid;
+        req->status = IO_QUEUED;
+
+        sq[sq_tail] = req;
+        sq_tail = (sq_tail + 1) % IO_QUEUE_DEPTH;
+        sq_count++;
+        return true;
+    }
+    return false;
+}
+
+// Mark a request done and wake its owner if it is waiting
+void io_complete(IoRequest* req, int64_t result) {
+    fat.close(req->file);  // the device is done with it
+    req->file = nullptr;
+
+    if (req->owner_pid == 0) {  // owner exited while in flight
+        req->status = IO_FREE;
+        return;
+    }
+
+    req->result = result;
+    req->status = IO_DONE;
+
+    Process* p = scheduler_get_proc_by_pid(req->owner_pid);
+    if (p && p->state == PROC_BLOCKED && p->wait_queue == &io_waiters) wait_wake(p, WAIT_OK);
+}
+
+// Hand every queued request to the device
+void io_service() {
+    while (sq_count > 0) {
+        IoRequest* req = sq[sq_head];
+        sq_head = (sq_head + 1) % IO_QUEUE_DEPTH;
+        sq_count--;
+
+        req->status = IO_INFLIGHT;
+        device_start(req);
+    }
+}
+
+int io_reap(int pid, IoCqe* out, int max) {
+    int n = 0;
+    for (int i = 0; i < IO_QUEUE_DEPTH && n < max; ++i) {
+        IoRequest* req = &io_table[i];
+        if (req->status != IO_DONE || req->owner_pid != pid) continue;
+
+        out[n].user_data = req->user_data;
+        out[n].result = req->result;
+        n++;
+
+        req->status = IO_FREE;
+        req->owner_pid = 0;
+    }
+    return n;
+}
+
+// Returns the number of unreaped requests (queued, in flight, or done)
+int io_pending(int pid) {
+    int n = 0;
+    for (int i = 0; i < IO_QUEUE_DEPTH; ++i) {
+        if (io_table[i].status != IO_FREE && io_table[i].owner_pid == pid) n++;
+    }
+    return n;
+}
+
+// Drop everything a process still has outstanding. Queued entries are
+// turned into no-ops so the ring stays consistent.
+void io_release(int pid) {
+    for (int i = 0; i < IO_QUEUE_DEPTH; ++i) {
+        IoRequest* req = &io_table[i];
+        if (req->owner_pid != pid) continue;
+
+        if (req->status == IO_QUEUED || req->status == IO_INFLIGHT) {
+            if (req->status == IO_QUEUED) req->op = IO_NOP;
+            req->owner_pid = 0;   // freed by io_complete
+        } else if (req->status == IO_DONE) {
+            req->status = IO_FREE;
+            req->owner_pid = 0;
+        }
+    }
+}
+
+// ---------------------------------------------------------------------
+// Syscall entry points
+// ---------------------------------------------------------------------
+
+// Queue a batch of requests with one trap; returns how many were accepted
+int64_t io_submit_batch(const IoSqe* sqes, int count) {
+    if (!sqes || count < 0) return -1;
+
+    int n = 0;
+    while (n < count && io_submit(&sqes[n], current)) n++;
+    return n;
+}
+
+// Block until at least min_complete requests are done, then reap up to max
+int64_t io_wait(IoCqe* out, int max, int min_complete) {
+    if (!out || max <= 0) return -1;
+    if (min_complete > max) min_complete = max;
+
+    int done = 0;
+    for (int i = 0; i < IO_QUEUE_DEPTH; ++i) {
+        if (io_table[i].status == IO_DONE && io_table[i].owner_pid == current) done++;
+    }
+
+    // Sleep until a completion arrives, then re-run this check (nothing is
+    // reaped now; the block takes effect when the syscall returns)
+    if (done < min_complete && io_pending(current) > done &&
+        wait_block(&io_waiters, BLOCK_IO, 0, true)) {
+        return 0;
+    }
+
+    return io_reap(current, out, max);
+}
@@ -0,0 +1,79 @@
+/* Copyright (c) 2025, Rye Stahle-Smith
+December 2nd, 2025 - io.h
+Description: Asynchronous I/O request queue definitions: submission/completion entries, request states, and the batch submission API. */
+#ifndef IO_H
+#define IO_H
+
+#pragma once
+#include <stdint.h>
+
+#define IO_QUEUE_DEPTH 16  // requests in flight across all processes
+
+struct OpenFile;
+
+// Request opcodes
+enum IoOp {
+    IO_NOP,
+    IO_READ
+};
+
+// Request lifecycle
+enum IoStatus {
+    IO_FREE,
+    IO_QUEUED,    // waiting in the submission queue
+    IO_INFLIGHT,  // handed to the device
+    IO_DONE       // completed, waiting to be reaped
+};
+
+// Submission entry as passed in by user programs
+struct IoSqe {
+    uint32_t op;
+    int32_t fd;
+    int32_t offset;
+    int32_t len;
+    uint64_t buf;
+    uint64_t user_data;
+};
+
+// Completion entry returned to user programs
+struct IoCqe {
+    uint64_t user_data;
+    int64_t result;
+};
+
+// Kernel-side request slot
+struct IoRequest {
+    IoOp op;
+    OpenFile* file;  // own reference, dropped by io_complete
+    int offset;
+    int len;
+    uint8_t* buf;
+    uint64_t user_data;
+    int64_t result;
+    int owner_pid;
+    IoStatus status;
+};
+
+// Device backend: start a request; must later call io_complete() for it
+typedef void (*IoStartFn)(IoRequest* req);
+
+void io_init();
+void io_set_device(IoStartFn start);
+
+// Queue one request; returns false if the queue is full
+bool io_submit(const IoSqe* sqe, int pid);
+
+// Completion path (called from the device interrupt / service loop)
+void io_complete(IoRequest* req, int64_t result);
+void io_service();
+
+// Reap up to max completions for a process
+int io_reap(int pid, IoCqe* out, int max);
+int io_pending(int pid);
+void io_release(int pid);
+
+// Syscall entry points
+int64_t io_submit_batch(const IoSqe* sqes, int count);
+int64_t io_wait(IoCqe* out, int max, int min_complete);
+
+#endif
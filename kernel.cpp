@@ -80,12 +80,13 @@ bool service_userprog() {
         }
 
         for (uint32_t b = 0; b < copy_size; b++) {
-            f->data[b] = ef->source[b];
+            f->inode->data[b] = ef->source[b];
         }
         
         // Set file size (don't add extra null terminator if source already has one)
-        f->size = copy_size;
-        f->used = true;
+        f->inode->size = copy_size;
+        f->inode->mode = MODE_DEFAULT | MODE_EXEC;
+        fat.mark_modified(f->inode);
     }
 
     return true;
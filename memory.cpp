@@ -1,50 +1,612 @@
 /* Copyright (c) 2025, Rye Stahle-Smith
 December 2nd, 2025 - memory.cpp
-Description: Simple bump allocator and memory utilities used by the kernel and process loader for stack, heap, and program memory allocation. */
+Description: Kernel heap: a page allocator over the linker-reserved region, size-class slabs for small objects with per-hart magazine caches in front of a shared depot, per-subsystem usage accounting, reclaim on allocation failure, and process memory helpers. */
 #include "shell.h"
 #include "memory.h"
 
 // ------------------------------------------------------------
-//  Simple bump allocator
+//  Heap layout
 // ------------------------------------------------------------
-// Change this to wherever you want your kernel heap to begin.
-// For now, we'll just define a linker symbol and assign it.
+// The heap region is carved into 4 KiB pages. Small requests (up to
+// 2 KiB) come from size-class slabs; larger ones get a run of whole pages.
+// Every page has a descriptor, so kfree can tell which layer owns a block.
 
 extern uint8_t _kernel_heap_start;   // defined in linker.ld
 extern uint8_t _kernel_heap_end;     // defined in linker.ld
 
-static uint8_t* heap_ptr = &_kernel_heap_start;
-static uint8_t* heap_limit = &_kernel_heap_end;
+static const uint64_t PAGE_SIZE = 4096;
+
+#define KMEM_MAX_PAGES (10 * 1024 * 1024 / 4096)  // heap reservation in linker.ld
+#define KMEM_MIN_SHIFT 4                          // smallest class: 16 bytes
+#define KMEM_CLASSES 8                            // 16 .. 2048 bytes
+#define KMEM_MAX_SMALL (1u << (KMEM_MIN_SHIFT + KMEM_CLASSES - 1))
+
+#define MAG_SIZE 16          // objects per magazine
+#define KMEM_MAGAZINES 64    // magazine structs shared by all classes and harts
+#define DEPOT_MAX_FULL 4     // full magazines a class may park before draining
+#define KMEM_MAX_HARTS 1
+#define KMEM_MAX_RECLAIM 4   // registered reclaim hooks
+
+enum PageKind : uint8_t {
+    PAGE_UNUSED,  // free run or never handed out
+    PAGE_SLAB,    // carved into objects of one size class
+    PAGE_LARGE,   // first page of a large allocation
+    PAGE_TAIL     // later page of a large allocation
+};
+
+struct PageDesc {
+    PageKind kind;
+    uint8_t cls;     // PAGE_SLAB: size class
+    uint8_t tag;     // PAGE_LARGE: MemTag charged
+    uint16_t pages;  // PAGE_LARGE: length of the run
+    uint16_t free_objs;  // PAGE_SLAB: scratch count while reclaiming
+};
+
+// A free run of pages; the header lives in the first free page
+struct FreeRun {
+    uint64_t pages;
+    FreeRun* next;
+};
+
+// A magazine is a small stack of free objects of one size class
+struct Magazine {
+    void* objs[MAG_SIZE];
+    int count;
+    Magazine* next;
+};
+
+// Per-hart view of one size class: two magazines, so a hart alternating
+// alloc and free at a magazine boundary does not bounce off the depot
+struct CpuClassCache {
+    Magazine* loaded;
+    Magazine* previous;
+};
+
+struct HartCache {
+    CpuClassCache classes[KMEM_CLASSES];
+};
+
+// Shared per-class state behind the hart caches
+struct Depot {
+    Magazine* full;  // magazines ready to hand to a hart
+    int full_count;
+    void* slab_free; // intrusive list of free objects in this class's slabs
+};
+
+static uint8_t* heap_base;
+static uint8_t* heap_ptr;    // first page never handed out
+static uint8_t* heap_limit;
+static PageDesc page_desc[KMEM_MAX_PAGES];
+static FreeRun* free_runs;   // address-ordered, coalesced
+
+static HartCache hart_caches[KMEM_MAX_HARTS];
+static Depot depot[KMEM_CLASSES];
+static Magazine magazine_pool[KMEM_MAGAZINES];
+static Magazine* empty_magazines;
+static bool kmem_ready = false;
+
+static ReclaimFn reclaim_hooks[KMEM_MAX_RECLAIM];
+static int reclaim_count;
+
+// ------------------------------------------------------------
+//  Accounting
+// ------------------------------------------------------------
+// Blocks are charged at their real size (size class or whole pages).
+// Objects parked in magazines count as free. A slab object's tag lives in
+// a nibble map, one entry per 16 bytes of heap; large blocks keep theirs
+// in the page descriptor.
+
+static_assert(MEM_TAG_COUNT <= 16, "tags must fit in a nibble");
+
+struct TagStats {
+    uint64_t live;    // bytes currently allocated
+    uint64_t peak;    // high-water mark of live
+    uint32_t allocs;
+    uint32_t frees;
+};
+
+static const char* const tag_names[MEM_TAG_COUNT] = {
+    "misc", "stack", "code", "pool", "bench"
+};
+
+static TagStats tag_stats[MEM_TAG_COUNT];
+static uint8_t slab_tags[KMEM_MAX_PAGES * 4096 / 32];
+static uint32_t slab_pages;
+static uint32_t large_pages;
+
+static void charge(MemTag tag, uint64_t bytes) {
+    TagStats& t = tag_stats[tag];
+    t.live += bytes;
+    t.allocs++;
+    if (t.live > t.peak) t.peak = t.live;
+}
+
+static void uncharge(MemTag tag, uint64_t bytes) {
+    tag_stats[tag].live -= bytes;
+    tag_stats[tag].frees++;
+}
+
+static MemTag slab_tag(const void* p) {
+    uint64_t unit = ((const uint8_t*)p - heap_base) >> KMEM_MIN_SHIFT;
+    return (MemTag)((slab_tags[unit >> 1] >> ((unit & 1) * 4)) & 0xF);
+}
+
+static void set_slab_tag(const void* p, MemTag tag) {
+    uint64_t unit = ((const uint8_t*)p - heap_base) >> KMEM_MIN_SHIFT;
+    int shift = (unit & 1) * 4;
+    uint8_t& b = slab_tags[unit >> 1];
+    b = (uint8_t)((b & ~(0xF << shift)) | (tag << shift));
+}
+
+#ifdef KMEM_DEBUG
+// ------------------------------------------------------------
+//  Debug: a backtrace per live block
+// ------------------------------------------------------------
+// Walks the frame-pointer chain (the Makefile adds -fno-omit-frame-pointer
+// with KMEM_DEBUG); on RISC-V the saved ra sits at fp-8 and the caller's
+// fp at fp-16.
+
+#define KMEM_TRACE_MAX 256
+#define KMEM_TRACE_DEPTH 4
+
+extern uint8_t _stack_start;  // top of RAM, defined in linker.ld
+
+struct AllocTrace {
+    void* ptr;
+    uint32_t size;
+    MemTag tag;
+    uint64_t pc[KMEM_TRACE_DEPTH];
+};
+
+static AllocTrace traces[KMEM_TRACE_MAX];
+static uint32_t traces_dropped;
+
+static bool frame_ok(uint64_t fp) {
+    return (fp & 7) == 0 && fp > (uint64_t)&_kernel_heap_start && fp <= (uint64_t)&_stack_start;
+}
+
+// fp is the frame of kmalloc, so the first pc recorded is its caller
+static void trace_alloc(void* ptr, uint64_t size, MemTag tag, uint64_t fp) {
+    AllocTrace* t = nullptr;
+    for (int i = 0; i < KMEM_TRACE_MAX && !t; ++i) {
+        if (!traces[i].ptr) t = &traces[i];
+    }
+    if (!t) {
+        traces_dropped++;
+        return;
+    }
+
+    t->ptr = ptr;
+    t->size = (uint32_t)size;
+    t->tag = tag;
+
+    for (int d = 0; d < KMEM_TRACE_DEPTH; ++d) {
+        t->pc[d] = 0;
+        if (!frame_ok(fp)) continue;
+        t->pc[d] = ((uint64_t*)fp)[-1];
+        uint64_t caller = ((uint64_t*)fp)[-2];
+        fp = caller > fp ? caller : 0;  // stacks grow down: callers sit higher
+    }
+}
+
+static void trace_free(void* ptr) {
+    for (int i = 0; i < KMEM_TRACE_MAX; ++i) {
+        if (traces[i].ptr == ptr) {
+            traces[i].ptr = nullptr;
+            return;
+        }
+    }
+}
+#endif
+
+static void kmem_init() {
+    uintptr_t start = ((uintptr_t)&_kernel_heap_start + PAGE_SIZE - 1) & ~(PAGE_SIZE - 1);
+    uintptr_t end = (uintptr_t)&_kernel_heap_end & ~(PAGE_SIZE - 1);
+    if (end > start + KMEM_MAX_PAGES * PAGE_SIZE) end = start + KMEM_MAX_PAGES * PAGE_SIZE;
+
+    heap_base = (uint8_t*)start;
+    heap_ptr = heap_base;
+    heap_limit = (uint8_t*)end;
+    free_runs = nullptr;
+
+    empty_magazines = nullptr;
+    for (int i = 0; i < KMEM_MAGAZINES; ++i) {
+        magazine_pool[i].count = 0;
+        magazine_pool[i].next = empty_magazines;
+        empty_magazines = &magazine_pool[i];
+    }
+    kmem_ready = true;
+}
+
+static uint64_t page_index(const void* p) {
+    return ((const uint8_t*)p - heap_base) / PAGE_SIZE;
+}
+
+// ------------------------------------------------------------
+//  Page runs
+// ------------------------------------------------------------
+
+// First fit from the free runs, then from the untouched end of the heap
+static void* page_alloc_run(uint64_t pages) {
+    for (FreeRun** link = &free_runs; *link; link = &(*link)->next) {
+        FreeRun* run = *link;
+        if (run->pages < pages) continue;
+
+        if (run->pages == pages) {
+            *link = run->next;
+        } else {
+            FreeRun* rest = (FreeRun*)((uint8_t*)run + pages * PAGE_SIZE);
+            rest->pages = run->pages - pages;
+            rest->next = run->next;
+            *link = rest;
+        }
+        return run;
+    }
+
+    if (heap_ptr + pages * PAGE_SIZE > heap_limit) return nullptr;
+    void* result = heap_ptr;
+    heap_ptr += pages * PAGE_SIZE;
+    return result;
+}
+
+// Return a run, merging it with free neighbours on either side
+static void page_free_run(void* p, uint64_t pages) {
+    uint64_t first = page_index(p);
+    for (uint64_t i = 0; i < pages; ++i) page_desc[first + i].kind = PAGE_UNUSED;
+
+    FreeRun* run = (FreeRun*)p;
+    run->pages = pages;
+
+    FreeRun* prev = nullptr;
+    FreeRun* next = free_runs;
+    while (next && next < run) {
+        prev = next;
+        next = next->next;
+    }
+
+    if (next && (uint8_t*)run + run->pages * PAGE_SIZE == (uint8_t*)next) {
+        run->pages += next->pages;
+        next = next->next;
+    }
+    run->next = next;
+
+    if (prev && (uint8_t*)prev + prev->pages * PAGE_SIZE == (uint8_t*)run) {
+        prev->pages += run->pages;
+        prev->next = run->next;
+    } else if (prev) {
+        prev->next = run;
+    } else {
+        free_runs = run;
+    }
+}
+
+static void* large_alloc(uint64_t size, MemTag tag) {
+    uint64_t pages = (size + PAGE_SIZE - 1) / PAGE_SIZE;
+    void* p = page_alloc_run(pages);
+    if (!p) return nullptr;
+
+    uint64_t first = page_index(p);
+    page_desc[first] = { PAGE_LARGE, 0, tag, (uint16_t)pages, 0 };
+    for (uint64_t i = 1; i < pages; ++i) page_desc[first + i] = { PAGE_TAIL, 0, MEM_MISC, 0, 0 };
+    large_pages += pages;
+    charge(tag, pages * PAGE_SIZE);
+    return p;
+}
+
+// ------------------------------------------------------------
+//  Slabs
+// ------------------------------------------------------------
+
+static int size_class(uint64_t size) {
+    int cls = 0;
+    while ((1ULL << (KMEM_MIN_SHIFT + cls)) < size) ++cls;
+    return cls;
+}
+
+// Carve a fresh page into objects of one class
+static bool slab_grow(int cls) {
+    uint8_t* page = (uint8_t*)page_alloc_run(1);
+    if (!page) return false;
+
+    page_desc[page_index(page)] = { PAGE_SLAB, (uint8_t)cls, MEM_MISC, 1, 0 };
+    slab_pages++;
+
+    uint64_t obj_size = 1ULL << (KMEM_MIN_SHIFT + cls);
+    for (uint64_t off = PAGE_SIZE; off >= obj_size; off -= obj_size) {
+        void** obj = (void**)(page + off - obj_size);
+        *obj = depot[cls].slab_free;
+        depot[cls].slab_free = obj;
+    }
+    return true;
+}
+
+static void* slab_alloc(int cls) {
+    Depot& d = depot[cls];
+    if (!d.slab_free && !slab_grow(cls)) return nullptr;
+
+    void** obj = (void**)d.slab_free;
+    d.slab_free = *obj;
+    return obj;
+}
+
+static void slab_free(int cls, void* p) {
+    *(void**)p = depot[cls].slab_free;
+    depot[cls].slab_free = p;
+}
 
 // ------------------------------------------------------------
-// Allocate 'size' bytes from kernel heap, naturally aligned.
-// No deallocation yet (not needed until later)
+//  Depot: the only state shared between harts
 // ------------------------------------------------------------
-void* kmalloc(uint64_t size) {
+
+static Magazine* depot_get_empty() {
+    Magazine* m = empty_magazines;
+    if (m) {
+        empty_magazines = m->next;
+        m->count = 0;
+    }
+    return m;
+}
+
+static void depot_put_empty(Magazine* m) {
+    m->count = 0;
+    m->next = empty_magazines;
+    empty_magazines = m;
+}
+
+// Hand out a full magazine, refilling one from the slabs in a batch if
+// the depot has none parked
+static Magazine* depot_get_full(int cls) {
+    Depot& d = depot[cls];
+    if (d.full) {
+        Magazine* m = d.full;
+        d.full = m->next;
+        d.full_count--;
+        return m;
+    }
+
+    Magazine* m = depot_get_empty();
+    if (!m) return nullptr;
+    while (m->count < MAG_SIZE) {
+        void* obj = slab_alloc(cls);
+        if (!obj) break;
+        m->objs[m->count++] = obj;
+    }
+    if (m->count == 0) {
+        depot_put_empty(m);
+        return nullptr;
+    }
+    return m;
+}
+
+// Park a full magazine, draining it back to the slabs in a batch once the
+// class already holds enough spares
+static void depot_put_full(int cls, Magazine* m) {
+    Depot& d = depot[cls];
+    if (d.full_count >= DEPOT_MAX_FULL) {
+        while (m->count > 0) slab_free(cls, m->objs[--m->count]);
+        depot_put_empty(m);
+        return;
+    }
+    m->next = d.full;
+    d.full = m;
+    d.full_count++;
+}
+
+// ------------------------------------------------------------
+//  Hart-local magazine layer
+// ------------------------------------------------------------
+
+static HartCache* this_hart() {
+    uint64_t hartid;
+    asm volatile("csrr %0, mhartid" : "=r"(hartid));
+    return &hart_caches[hartid % KMEM_MAX_HARTS];
+}
+
+static void swap_magazines(CpuClassCache& c) {
+    Magazine* m = c.loaded;
+    c.loaded = c.previous;
+    c.previous = m;
+}
+
+static void* cache_alloc(int cls) {
+    CpuClassCache& c = this_hart()->classes[cls];
+    for (;;) {
+        if (c.loaded && c.loaded->count > 0) return c.loaded->objs[--c.loaded->count];
+        if (c.previous && c.previous->count > 0) {
+            swap_magazines(c);
+            continue;
+        }
+
+        // Both empty: trade one for a full magazine from the depot
+        Magazine* full = depot_get_full(cls);
+        if (!full) return nullptr;
+        if (c.previous) depot_put_empty(c.previous);
+        c.previous = c.loaded;
+        c.loaded = full;
+    }
+}
+
+static void cache_free(int cls, void* p) {
+    CpuClassCache& c = this_hart()->classes[cls];
+    for (;;) {
+        if (c.loaded && c.loaded->count < MAG_SIZE) {
+            c.loaded->objs[c.loaded->count++] = p;
+            return;
+        }
+        if (c.previous && c.previous->count == 0) {
+            swap_magazines(c);
+            continue;
+        }
+
+        // Both full: trade one for an empty magazine
+        Magazine* empty = depot_get_empty();
+        if (!empty) {
+            slab_free(cls, p);  // out of magazines: bypass the cache
+            return;
+        }
+        if (c.previous) depot_put_full(cls, c.previous);
+        c.previous = c.loaded;
+        c.loaded = empty;
+    }
+}
+
+// ------------------------------------------------------------
+//  Reclaim
+// ------------------------------------------------------------
+
+static void drain_magazine(int cls, Magazine* m) {
+    if (!m) return;
+    while (m->count > 0) slab_free(cls, m->objs[--m->count]);
+    depot_put_empty(m);
+}
+
+// Give slab pages whose objects are all free back to the page allocator:
+// count free objects per page, unlink those of wholly free pages, then
+// free the pages
+static void slab_release_empty(int cls) {
+    Depot& d = depot[cls];
+    uint16_t per_page = (uint16_t)(PAGE_SIZE >> (KMEM_MIN_SHIFT + cls));
+
+    for (void* o = d.slab_free; o; o = *(void**)o) page_desc[page_index(o)].free_objs++;
+
+    void** link = &d.slab_free;
+    while (*link) {
+        void* o = *link;
+        if (page_desc[page_index(o)].free_objs == per_page) *link = *(void**)o;
+        else link = (void**)o;
+    }
+
+    uint64_t pages = (heap_ptr - heap_base) / PAGE_SIZE;
+    for (uint64_t i = 0; i < pages; ++i) {
+        PageDesc& pd = page_desc[i];
+        if (pd.kind != PAGE_SLAB || pd.cls != cls) continue;
+        bool empty = pd.free_objs == per_page;
+        pd.free_objs = 0;
+        if (empty) {
+            slab_pages--;
+            page_free_run(heap_base + i * PAGE_SIZE, 1);
+        }
+    }
+}
+
+// Drain every magazine (this hart's and the depot's) into the slabs and
+// release empty slab pages. Returns true if any page was freed.
+static bool kmem_reclaim_caches() {
+    uint32_t before = slab_pages;
+    HartCache* hc = this_hart();
+
+    for (int cls = 0; cls < KMEM_CLASSES; ++cls) {
+        CpuClassCache& c = hc->classes[cls];
+        drain_magazine(cls, c.loaded);
+        drain_magazine(cls, c.previous);
+        c.loaded = c.previous = nullptr;
+
+        Depot& d = depot[cls];
+        while (d.full) {
+            Magazine* m = d.full;
+            d.full = m->next;
+            drain_magazine(cls, m);
+        }
+        d.full_count = 0;
+
+        slab_release_empty(cls);
+    }
+    return slab_pages < before;
+}
+
+void kmem_register_reclaim(ReclaimFn fn) {
+    for (int i = 0; i < reclaim_count; ++i) {
+        if (reclaim_hooks[i] == fn) return;
+    }
+    if (reclaim_count < KMEM_MAX_RECLAIM) reclaim_hooks[reclaim_count++] = fn;
+}
+
+// First hook that makes progress wins; the caller retries after each
+static bool run_reclaim(uint64_t wanted) {
+    if (kmem_reclaim_caches()) return true;
+    for (int i = 0; i < reclaim_count; ++i) {
+        if (reclaim_hooks[i](wanted)) return true;
+    }
+    return false;
+}
+
+static void* kmem_alloc(uint64_t size, MemTag tag) {
+    if (size > KMEM_MAX_SMALL) return large_alloc(size, tag);
+
+    int cls = size_class(size);
+    void* result = cache_alloc(cls);
+    if (result) {
+        set_slab_tag(result, tag);
+        charge(tag, 1ULL << (KMEM_MIN_SHIFT + cls));
+    }
+    return result;
+}
+
+// ------------------------------------------------------------
+// Allocate 'size' bytes from the kernel heap, 16-byte aligned
+// (small classes are naturally aligned, large blocks page aligned)
+// ------------------------------------------------------------
+void* kmalloc(uint64_t size, MemTag tag) {
     if (size == 0) return nullptr;
+    if (!kmem_ready) kmem_init();
+    if (tag >= MEM_TAG_COUNT) tag = MEM_MISC;
 
-    // Align to 16 bytes
-    size = (size + 15) & ~15ULL;
+    void* result = kmem_alloc(size, tag);
+    while (!result && run_reclaim(size)) result = kmem_alloc(size, tag);
 
-    if (heap_ptr + size >= heap_limit) {
+    if (!result) {
         print_str("(memory) Out of memory!\n");
         return nullptr;
     }
+#ifdef KMEM_DEBUG
+    trace_alloc(result, size, tag, (uint64_t)__builtin_frame_address(0));
+#endif
+    return result;
+}
 
-    void* result = heap_ptr;
-    heap_ptr += size;
+uint64_t kmem_size(const void* ptr) {
+    const uint8_t* p = (const uint8_t*)ptr;
+    if (!p || !kmem_ready || p < heap_base || p >= heap_ptr) return 0;
 
-    return result;
+    const PageDesc& d = page_desc[page_index(p)];
+    if (d.kind == PAGE_SLAB) return 1ULL << (KMEM_MIN_SHIFT + d.cls);
+    if (d.kind == PAGE_LARGE) return (uint64_t)d.pages * PAGE_SIZE;
+    return 0;
+}
+
+void kfree(void* ptr) {
+    if (!ptr || !kmem_ready) return;
+
+    uint8_t* p = (uint8_t*)ptr;
+    if (p < heap_base || p >= heap_ptr) {
+        print_str("(memory) kfree: pointer outside the heap\n");
+        return;
+    }
+
+    PageDesc& d = page_desc[page_index(p)];
+    if (d.kind == PAGE_SLAB) {
+        uncharge(slab_tag(ptr), 1ULL << (KMEM_MIN_SHIFT + d.cls));
+        cache_free(d.cls, ptr);
+    } else if (d.kind == PAGE_LARGE && ((uintptr_t)p & (PAGE_SIZE - 1)) == 0) {
+        uint64_t pages = d.pages;
+        uncharge((MemTag)d.tag, pages * PAGE_SIZE);
+        large_pages -= pages;
+        page_free_run(ptr, pages);
+    } else {
+        print_str("(memory) kfree: not an allocated block\n");
+        return;
+    }
+#ifdef KMEM_DEBUG
+    trace_free(ptr);
+#endif
 }
 
 // ------------------------------------------------------------
 // Page allocator for processes (4 KiB pages)
 // ------------------------------------------------------------
 
-static const uint64_t PAGE_SIZE = 4096;
-
-void* alloc_page() {
-    return kmalloc(PAGE_SIZE);
+void* alloc_page(MemTag tag) {
+    return kmalloc(PAGE_SIZE, tag);
 }
 
 // ------------------------------------------------------------
@@ -52,20 +614,115 @@ void* alloc_page() {
 // ------------------------------------------------------------
 
 // Allocate memory for a new process: code + stack
-ProcessMemory alloc_process_memory(uint64_t code_size, uint64_t stack_size) {
+ProcessMemory alloc_process_memory(uint64_t code_size, uint64_t stack_size, uint64_t kstack_size) {
     ProcessMemory mem;
 
-    mem.code = (uint8_t*) kmalloc(code_size);
+    mem.code = code_size ? (uint8_t*) kmalloc(code_size, MEM_CODE) : nullptr;
     mem.code_size = code_size;
 
-    mem.stack = (uint8_t*) kmalloc(stack_size);
+    mem.stack = (uint8_t*) kmalloc(stack_size, MEM_STACK);
     mem.stack_size = stack_size;
 
-    if (!mem.code || !mem.stack) {
+    mem.kstack = (uint8_t*) kmalloc(kstack_size, MEM_STACK);
+    mem.kstack_size = kstack_size;
+
+    if ((code_size && !mem.code) || !mem.stack || !mem.kstack) {
         print_str("(memory) Failed to allocate process memory\n");
+        kfree(mem.code);
+        kfree(mem.stack);
+        kfree(mem.kstack);
         mem.code = nullptr;
         mem.stack = nullptr;
+        mem.kstack = nullptr;
     }
 
     return mem;
 }
+
+// ------------------------------------------------------------
+// Shell commands (registered through MEMORY_COMMANDS)
+// ------------------------------------------------------------
+static void print_kb(uint64_t bytes) {
+    char buf[16];
+    itoa((uint32_t)(bytes / 1024), buf, 10);
+    print_str(buf);
+    print_str(" KB");
+}
+
+void cmd_meminfo(const char* args) {
+    if (!kmem_ready) kmem_init();
+
+    bool list = args && strcmp(args, "-l") == 0;
+    if (args && args[0] && !list) {
+        shell_fail("Usage: meminfo [-l]\n");
+        return;
+    }
+
+    uint64_t heap = heap_limit - heap_base;
+    uint64_t touched = heap_ptr - heap_base;
+    uint64_t in_use = (uint64_t)(slab_pages + large_pages) * PAGE_SIZE;
+
+    print_str("Heap: ");
+    print_kb(heap);
+    print_str(", in use ");
+    print_kb(in_use);
+    print_str(" (slabs ");
+    print_kb((uint64_t)slab_pages * PAGE_SIZE);
+    print_str(", pages ");
+    print_kb((uint64_t)large_pages * PAGE_SIZE);
+    print_str("), free ");
+    print_kb(heap - in_use);
+    print_str(" (");
+    print_kb(heap - touched);
+    print_str(" never used)\n\n");
+
+    print_str("Tag\tLive\tPeak\tAllocs\tFrees\n");
+    print_str("---------------------------------------\n");
+    char buf[16];
+    for (int i = 0; i < MEM_TAG_COUNT; ++i) {
+        TagStats& t = tag_stats[i];
+        print_str(tag_names[i]);
+        print_str("\t");
+        itoa((uint32_t)t.live, buf, 10);
+        print_str(buf);
+        print_str("\t");
+        itoa((uint32_t)t.peak, buf, 10);
+        print_str(buf);
+        print_str("\t");
+        itoa(t.allocs, buf, 10);
+        print_str(buf);
+        print_str("\t");
+        itoa(t.frees, buf, 10);
+        print_str(buf);
+        print_str("\n");
+    }
+
+    if (!list) return;
+
+#ifdef KMEM_DEBUG
+    print_str("\nLive blocks (address size tag <- callers):\n");
+    for (int i = 0; i < KMEM_TRACE_MAX; ++i) {
+        AllocTrace& t = traces[i];
+        if (!t.ptr) continue;
+        print_hex((uint32_t)(uintptr_t)t.ptr);
+        print_str(" ");
+        itoa(t.size, buf, 10);
+        print_str(buf);
+        print_str(" ");
+        print_str(tag_names[t.tag]);
+        print_str(" <-");
+        for (int d = 0; d < KMEM_TRACE_DEPTH && t.pc[d]; ++d) {
+            print_str(" ");
+            print_hex((uint32_t)t.pc[d]);
+        }
+        print_str("\n");
+    }
+    if (traces_dropped) {
+        itoa(traces_dropped, buf, 10);
+        print_str(buf);
+        print_str(" allocations not traced (table full)\n");
+    }
+#else
+    print_str("\nBlock tracing needs a KMEM_DEBUG build (make KMEM_DEBUG=1)\n");
+#endif
+}
@@ -1,28 +1,58 @@
 /* Copyright (c) 2025, Rye Stahle-Smith
 December 2nd, 2025 - memory.h
-Description: Memory allocation interface providing declarations for the bump allocator and kernel memory utilities. */
+Description: Memory allocation interface providing declarations for the kernel heap (slabs with per-hart magazine caches, page runs) and kernel memory utilities. */
 #ifndef MEMORY_H
 #define MEMORY_H
 
 #pragma once
 #include <stdint.h>
 
-// Structure describing a new process's memory (code + stack)
+// Structure describing a new process's memory (code + stack + kernel stack)
 struct ProcessMemory {
     uint8_t* code;
     uint64_t code_size;
 
     uint8_t* stack;
     uint64_t stack_size;
+
+    uint8_t* kstack;  // its traps are handled on this stack
+    uint64_t kstack_size;
+};
+
+// Subsystem an allocation is charged to (shown by meminfo). At most 16.
+enum MemTag : uint8_t {
+    MEM_MISC,
+    MEM_STACK,   // process, thread and kernel stacks
+    MEM_CODE,    // loaded program images
+    MEM_POOL,    // object pool growth
+    MEM_BENCH,   // benchmark scratch
+    MEM_TAG_COUNT
 };
 
-// Basic heap allocator
-void* kmalloc(uint64_t size);
+// Kernel heap. Requests up to 2 KiB are served from size-class slabs through
+// a per-hart magazine cache; larger ones get a run of whole pages. Each block
+// is charged to its tag until freed. Building with KMEM_DEBUG also records a
+// backtrace per live block (meminfo -l) to track down leaks.
+void* kmalloc(uint64_t size, MemTag tag = MEM_MISC);
+void kfree(void* ptr);  // nullptr is ignored
+uint64_t kmem_size(const void* ptr);  // bytes charged for a live block, 0 if none
+
+// When an allocation fails the heap first drains its own caches, then runs
+// reclaim hooks in registration order until one reports progress (returns
+// true), and retries; this repeats until the allocation fits or no hook can
+// free anything. The last hook registered is the OOM killer.
+typedef bool (*ReclaimFn)(uint64_t wanted);
+void kmem_register_reclaim(ReclaimFn fn);  // registering twice is a no-op
 
 // Page allocator (4 KiB)
-void* alloc_page();
+void* alloc_page(MemTag tag = MEM_MISC);
+
+// Allocate memory regions for a process, all or nothing: on failure all
+// pointers are nullptr and nothing stays allocated. code_size 0 = no image.
+ProcessMemory alloc_process_memory(uint64_t code_size, uint64_t stack_size, uint64_t kstack_size);
 
-// Allocate memory regions for a process
-ProcessMemory alloc_process_memory(uint64_t code_size, uint64_t stack_size);
+// Shell commands provided by the memory subsystem (see commands.h)
+#define MEMORY_COMMANDS(CMD) \
+    CMD("meminfo", cmd_meminfo, "'meminfo [-l]'\tShow heap usage per subsystem (-l: live blocks, KMEM_DEBUG).")
 
 #endif
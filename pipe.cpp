@@ -0,0 +1,96 @@
+/* Copyright (c) 2025, Rye Stahle-Smith
+December 2nd, 2025 - pipe.cpp
+Description: Ring-buffer pipe implementation used for shell pipelines and inter-process streaming. */
+#include "pipe.h"
+#include "shell.h"
+#include "scheduler.h"
+
+static Pipe pipe_table[MAX_PIPES];
+
+static void pipe_maybe_free(Pipe* p) {
+    if (p->readers == 0 && p->writers == 0) p->used = false;
+}
+
+void pipe_init() {
+    for (int i = 0; i < MAX_PIPES; ++i) pipe_table[i].used = false;
+}
+
+Pipe* pipe_create() {
+    for (int i = 0; i < MAX_PIPES; ++i) {
+        Pipe* p = &pipe_table[i];
+        if (p->used) continue;
+
+        p->used = true;
+        p->head = 0;
+        p->tail = 0;
+        p->count = 0;
+        p->readers = 1;
+        p->writers = 1;
+        wait_queue_init(&p->read_waiters);
+        wait_queue_init(&p->write_waiters);
+        return p;
+    }
+    return nullptr;
+}
+
+// Copies in at most two runs: up to the end of the ring, then from the start
+int pipe_write(Pipe* p, const void* data, int len) {
+    if (!p || !p->used || p->readers == 0) return -1;  // nobody will read it
+
+    const uint8_t* src = (const uint8_t*)data;
+    int space = PIPE_BUF_SIZE - p->count;
+    if (len > space) len = space;
+
+    int first = PIPE_BUF_SIZE - p->tail;
+    if (first > len) first = len;
+    memcpy(p->buf + p->tail, src, first);
+    memcpy(p->buf, src + first, len - first);
+
+    p->tail = (p->tail + len) % PIPE_BUF_SIZE;
+    p->count += len;
+    if (len > 0) wait_wake_all(&p->read_waiters, WAIT_OK);
+    return len;
+}
+
+int pipe_read(Pipe* p, void* data, int len) {
+    if (!p || !p->used) return -1;
+
+    uint8_t* dst = (uint8_t*)data;
+    if (len > p->count) len = p->count;
+
+    int first = PIPE_BUF_SIZE - p->head;
+    if (first > len) first = len;
+    memcpy(dst, p->buf + p->head, first);
+    memcpy(dst + first, p->buf, len - first);
+
+    p->head = (p->head + len) % PIPE_BUF_SIZE;
+    p->count -= len;
+    if (len > 0) wait_wake_all(&p->write_waiters, WAIT_OK);
+    return len;
+}
+
+// Waiters re-run their read or write when woken
+void pipe_wait(Pipe* p, bool for_write) {
+    if (!p || !p->used) return;
+    wait_block(for_write ? &p->write_waiters : &p->read_waiters, BLOCK_PIPE, 0, true);
+}
+
+void pipe_retain(Pipe* p, bool write_end) {
+    if (!p || !p->used) return;
+    if (write_end) p->writers++;
+    else p->readers++;
+}
+
+void pipe_close_read(Pipe* p) {
+    if (!p || !p->used || p->readers == 0) return;
+    p->readers--;
+    if (p->readers == 0) wait_wake_all(&p->write_waiters, WAIT_OK);  // writers now fail
+    pipe_maybe_free(p);
+}
+
+void pipe_close_write(Pipe* p) {
+    if (!p || !p->used || p->writers == 0) return;
+    p->writers--;
+    if (p->writers == 0) wait_wake_all(&p->read_waiters, WAIT_OK);  // readers now see EOF
+    pipe_maybe_free(p);
+}
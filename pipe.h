@@ -0,0 +1,45 @@
+/* Copyright (c) 2025, Rye Stahle-Smith
+December 2nd, 2025 - pipe.h
+Description: In-kernel pipe objects: fixed-size ring buffers with reader/writer reference counts and wait queues. */
+#ifndef PIPE_H
+#define PIPE_H
+
+#pragma once
+#include <stdint.h>
+
+#define MAX_PIPES 8
+#define PIPE_BUF_SIZE 4096
+
+#include "scheduler.h"
+
+struct Pipe {
+    uint8_t buf[PIPE_BUF_SIZE];
+    int head;     // next byte to read
+    int tail;     // next free byte
+    int count;    // bytes buffered
+    int readers;  // open read ends
+    int writers;  // open write ends
+    WaitQueue read_waiters;   // blocked until data or EOF
+    WaitQueue write_waiters;  // blocked until space or no readers
+    bool used;
+};
+
+void pipe_init();
+Pipe* pipe_create();
+
+// Copy up to len bytes without blocking; both return the number actually
+// transferred and wake the other side's waiters when anything moved
+int pipe_write(Pipe* p, const void* data, int len);
+int pipe_read(Pipe* p, void* data, int len);
+
+// Park the current process until the pipe becomes readable (or writable)
+void pipe_wait(Pipe* p, bool for_write);
+
+// Take another reference on one end (dup2, handing an end to a process)
+void pipe_retain(Pipe* p, bool write_end);
+
+// Drop one end; the pipe is freed when both sides are closed
+void pipe_close_read(Pipe* p);
+void pipe_close_write(Pipe* p);
+
+#endif
@@ -0,0 +1,133 @@
+/* Copyright (c) 2025, Rye Stahle-Smith
+December 2nd, 2025 - pool.h
+Description: Typed fixed-capacity object pools with O(1) allocation through a free list, optional growth from the page allocator, and usage counters. */
+#ifndef POOL_H
+#define POOL_H
+
+#pragma once
+#include <stdint.h>
+#include "memory.h"
+
+// N objects of type T stored contiguously, so callers may still scan them
+// by index (operator[]) and map an object back to its slot (index_of).
+// Freed slots are chained through a side array of indices rather than
+// through the objects, which keeps a free slot's fields readable by those
+// scans; slots never used yet are taken in order above a watermark.
+// Objects are not constructed or cleared: callers initialize every field
+// they use after alloc, as with a plain static table.
+//
+// With Grow set, an exhausted pool carves one more page into objects.
+// Grown objects have no index and are never visited by index scans; while
+// free they hold the free-list link in their own first bytes.
+template <typename T, int N, bool Grow = false>
+class ObjectPool {
+public:
+    // All-zero storage is already an empty pool (the kernel runs no global
+    // constructors); init() returns a pool to that state
+    void init() {
+        for (int i = 0; i < N; ++i) live[i] = false;
+        fresh = 0;
+        free_head = 0;
+        grown_free = nullptr;
+        grown = 0;
+        used_count = 0;
+        peak_count = 0;
+        failed_count = 0;
+    }
+
+    T* alloc() {
+        T* obj = nullptr;
+        int i = -1;
+        if (free_head) {
+            i = free_head - 1;
+            free_head = next_free[i];
+        } else if (fresh < N) {
+            i = fresh++;  // slots never handed out yet
+        }
+
+        if (i >= 0) {
+            live[i] = true;
+            obj = &items[i];
+        } else if (Grow && (grown_free || grow())) {
+            obj = (T*)grown_free;
+            grown_free = grown_free->next;
+        }
+
+        if (!obj) {
+            failed_count++;
+            return nullptr;
+        }
+        if (++used_count > peak_count) peak_count = used_count;
+        return obj;
+    }
+
+    // Freeing nullptr or an already free slot is a no-op
+    void free(T* obj) {
+        if (!obj) return;
+
+        int i = index_of(obj);
+        if (i >= 0) {
+            if (!live[i]) return;
+            live[i] = false;
+            next_free[i] = free_head;
+            free_head = i + 1;
+        } else {
+            FreeNode* node = (FreeNode*)obj;
+            node->next = grown_free;
+            grown_free = node;
+        }
+        used_count--;
+    }
+
+    T& operator[](int i) { return items[i]; }
+    const T& operator[](int i) const { return items[i]; }
+    T* data() { return items; }
+
+    // Slot of an object in the fixed array, -1 for grown (or foreign) objects
+    int index_of(const T* obj) const {
+        if (obj < items || obj >= items + N) return -1;
+        return (int)(obj - items);
+    }
+
+    int used() const { return used_count; }
+    int peak() const { return peak_count; }               // high-water mark
+    int failures() const { return failed_count; }         // allocs refused
+    int capacity() const { return N + grown; }
+    int available() const { return capacity() - used_count; }
+
+private:
+    struct FreeNode {
+        FreeNode* next;
+    };
+    static_assert(sizeof(T) >= sizeof(FreeNode), "pooled type too small for a free link");
+
+    static constexpr uint64_t GROW_BYTES = 4096;
+    static constexpr int GROW_COUNT = sizeof(T) < GROW_BYTES ? (int)(GROW_BYTES / sizeof(T)) : 1;
+
+    // Grown pages are never returned; the pool only ever gets larger
+    bool grow() {
+        T* chunk = (T*)kmalloc(GROW_COUNT * sizeof(T), MEM_POOL);
+        if (!chunk) return false;
+
+        for (int i = GROW_COUNT - 1; i >= 0; --i) {
+            FreeNode* node = (FreeNode*)&chunk[i];
+            node->next = grown_free;
+            grown_free = node;
+        }
+        grown += GROW_COUNT;
+        return true;
+    }
+
+    T items[N];
+    int16_t next_free[N];  // slot + 1 of the next freed slot, 0 ends the list
+    bool live[N];
+    int fresh;             // slots below this have been handed out before
+    int free_head;         // slot + 1, 0 = empty
+    FreeNode* grown_free;
+    int grown;
+    int used_count;
+    int peak_count;
+    int failed_count;
+};
+
+#endif
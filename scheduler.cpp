@@ -1,30 +1,63 @@
 /* Copyright (c) 2025, Rye Stahle-Smith
 December 2nd, 2025 - scheduler.cpp
-Description: Process scheduler with semaphore synchronization, blocking/waking, and concurrent round-robin execution. */
+Description: Process scheduler with wait queues, semaphore synchronization, blocking/waking with timeouts, and concurrent round-robin execution. */
 #include "scheduler.h"
 #include "shell.h"
 #include "memory.h"
+#include "fat.h"
+#include "timer.h"
+#include "io.h"
+#include "pipe.h"
+#include "sync.h"
+#include "vdso.h"
 
 static char proc_name_buf[MAX_PROCS][16];
 
 // Process table
-Process proc_table[MAX_PROCS];
+ObjectPool<Process, MAX_PROCS> proc_table;
 static int next_pid = 1;
 int current = -1;
 
 // Semaphore table
-static Semaphore sem_table[MAX_SEMS];
+static ObjectPool<Semaphore, MAX_SEMS> sem_table;
 static int next_sem_id = 1;
 
-// Kernel state
-uintptr_t kernel_saved_sp;
-uintptr_t kernel_resume_pc;
+// Kernel context a running process returns to when it exits, blocks or
+// yields. Runs nest (the shell runs programs), so each run saves the outer one.
+struct KernelContext {
+    uint64_t ra, sp;
+    uint64_t s[12];
+};
+static KernelContext* kernel_ctx = nullptr;
+
+// Processes blocked with a deadline; the timeout scan is skipped when zero
+static int timed_waiters = 0;
+
+// Set when the current syscall blocked or yielded (per hart under SMP)
+static bool switch_pending = false;
+
+// trap.S helpers
+extern "C" int context_save(KernelContext* ctx) __attribute__((returns_twice));
+extern "C" void context_restore(KernelContext* ctx) __attribute__((noreturn));
+extern "C" void process_start(void (*entry)(), uint8_t* stack_top, uint64_t arg) __attribute__((noreturn));
+extern "C" void trap_resume(TrapFrame* tf) __attribute__((noreturn));
+
+// kmalloc reclaim hooks (see "Memory pressure" below)
+static bool reclaim_zombie_stacks(uint64_t wanted);
+static bool oom_kill(uint64_t wanted);
 
 // Memory barrier for visibility
 static void memory_barrier() {
     asm volatile("fence rw,rw" ::: "memory");
 }
 
+// trap_vector switches to the stack in mscratch (0 = stay on the current one)
+static uint64_t swap_trap_stack(uint64_t top) {
+    uint64_t old;
+    asm volatile("csrrw %0, mscratch, %1" : "=r"(old) : "r"(top) : "memory");
+    return old;
+}
+
 // ---------------------------------------------------------------------
 // Internal helpers
 // ---------------------------------------------------------------------
@@ -36,28 +69,106 @@ static Process* pid_to_proc(int pid) {
     return nullptr;
 }
 
+// A slot taken here stays PROC_FREE until its creator fills it in, and
+// goes back to the pool in reap (or if creation fails)
 static Process* find_free_slot() {
-    for (int i = 0; i < MAX_PROCS; ++i) {
-        if (proc_table[i].state == PROC_FREE) return &proc_table[i];
+    return proc_table.alloc();
+}
+
+// Highest effective priority wins; ties go round-robin from start_idx.
+// RUNNING processes are already on the call chain (the shell running a
+// program), so only READY ones can be picked.
+static Process* find_next_ready(int start_idx) {
+    Process* best = nullptr;
+    for (int offset = 0; offset < MAX_PROCS; ++offset) {
+        int i = (start_idx + offset) % MAX_PROCS;
+        if (proc_table[i].state != PROC_READY) continue;
+        if (!best || proc_table[i].priority > best->priority) best = &proc_table[i];
     }
-    return nullptr;
+    return best;
+}
+
+// Clear per-run state when a slot is (re)used
+static void reset_wait_state(Process* p) {
+    p->tf = nullptr;
+    p->resume_pc = 0;
+    p->restart_syscall = false;
+    p->block_reason = BLOCK_NONE;
+    p->wait_queue = nullptr;
+    p->wait_prev = nullptr;
+    p->wait_next = nullptr;
+    p->wake_at = 0;
+    p->wake_result = WAIT_OK;
+    p->base_priority = PRIO_NORMAL;
+    p->priority = PRIO_NORMAL;
+    p->arg = 0;
+    p->exit_value = 0;
+    wait_queue_init(&p->joiners);
+    p->futex_addr = 0;
+}
+
+// Drop whatever a descriptor refers to and mark it unused
+void fd_release(FileDesc* fd) {
+    if (fd->kind == FD_FILE) fat.close(fd->file);
+    else if (fd->kind == FD_PIPE_READ) pipe_close_read(fd->pipe);
+    else if (fd->kind == FD_PIPE_WRITE) pipe_close_write(fd->pipe);
+
+    fd->kind = FD_NONE;
+    fd->file = nullptr;
+    fd->pipe = nullptr;
 }
 
-static Semaphore* find_free_sem_slot() {
+// Reset a descriptor table, closing anything still open
+static void release_fds(Process* p) {
+    for (int i = 0; i < MAX_FDS; ++i) fd_release(&p->fds[i]);
+}
+
+// Destroy the semaphores a process created
+static void sem_release(int pid) {
     for (int i = 0; i < MAX_SEMS; ++i) {
-        if (!sem_table[i].in_use) return &sem_table[i];
+        if (sem_table[i].in_use && sem_table[i].owner_pid == pid) sem_destroy(sem_table[i].id);
     }
-    return nullptr;
 }
 
-static Process* find_next_ready(int start_idx) {
-    // Search for next READY or RUNNING process, skipping blocked processes
-    for (int offset = 0; offset < MAX_PROCS; ++offset) {
-        int i = (start_idx + offset) % MAX_PROCS;
-        if (proc_table[i].state == PROC_READY || proc_table[i].state == PROC_RUNNING)
-            return &proc_table[i];
+// Release everything an exited process owns and free its slot. Every kernel
+// object records its owner, so one sweep per subsystem finds them all:
+// descriptors (and through them pipes), I/O requests, semaphores, and
+// mutexes/condition variables.
+static void reap(Process* p) {
+    int pid = p->pid;
+
+    // A process takes its remaining threads with it
+    if (p->tgid == pid) {
+        for (int i = 0; i < MAX_PROCS; ++i) {
+            Process* t = &proc_table[i];
+            if (t == p || t->state == PROC_FREE || t->tgid != pid) continue;
+            if (t->state == PROC_BLOCKED) wait_wake(t, WAIT_DESTROYED);
+            reap(t);
+        }
     }
-    return nullptr;
+    wait_wake_all(&p->joiners, WAIT_DESTROYED);
+
+    release_fds(p);
+    io_release(pid);
+    sem_release(pid);
+    sync_release(pid);
+
+    p->state = PROC_FREE;
+    p->tgid = 0;
+    kfree(p->code);
+    kfree(p->stack);
+    kfree(p->kstack);
+    p->entry = nullptr;
+    p->name = nullptr;
+    p->code = nullptr;
+    p->stack = nullptr;
+    p->stack_top = nullptr;
+    p->stack_size = 0;
+    p->kstack = nullptr;
+    p->kstack_top = nullptr;
+    reset_wait_state(p);
+    p->pid = 0;
+    proc_table.free(p);
 }
 
 void terminate_process(int pid) {
@@ -67,141 +178,296 @@ void terminate_process(int pid) {
     }
 }
 
-// Simple stack switch runner
+// Continue a process stopped inside a syscall: deliver the wake result (or
+// re-run the ecall) and return through trap_vector's restore sequence
+static void resume_process(Process* p) {
+    TrapFrame* tf = p->tf;
+    p->tf = nullptr;
+
+    tf->epc = p->resume_pc;
+    if (!p->restart_syscall || p->wake_result != WAIT_OK) {
+        tf->a0 = (uint64_t)p->wake_result;
+        tf->epc += 4;
+    }
+    trap_resume(tf);
+}
+
+// Run a process until it exits, blocks or yields
 static void run_process(Process* p) {
     if (!p || !p->entry) return;
 
-    print_str("(scheduler) Starting process '");
-    print_str(p->name);
-    print_str("' [PID ");
-    char pid_str[16];
-    itoa(p->pid, pid_str, 10);
-    print_str(pid_str);
-    print_str("]...\n");
+    bool fresh = (p->tf == nullptr);
+    if (fresh) {
+        print_str("(scheduler) Starting process '");
+        print_str(p->name);
+        print_str("' [PID ");
+        char pid_str[16];
+        itoa(p->pid, pid_str, 10);
+        print_str(pid_str);
+        print_str("]...\n");
+    }
 
-    uintptr_t saved_sp;
-    asm volatile("mv %0, sp" : "=r"(saved_sp));
+    KernelContext ctx;
+    KernelContext* outer_ctx = kernel_ctx;
+    int outer_pid = current;
+    uint64_t outer_trap_stack = swap_trap_stack(0);
+
+    if (context_save(&ctx) == 0) {
+        kernel_ctx = &ctx;
+        current = p->pid;
+        vdso_switch(p->pid, p->tgid);
+        p->state = PROC_RUNNING;
+        memory_barrier();
+
+        swap_trap_stack((uint64_t)p->kstack_top);  // its traps land on its own kernel stack
+        if (!fresh) resume_process(p);
+        process_start(p->entry, p->stack_top, p->arg);  // exits through scheduler_exit_current
+    }
 
-    kernel_saved_sp = saved_sp;
-    kernel_resume_pc = (uintptr_t)&scheduler_process_return;
+    // Back on this stack: the process exited, blocked or yielded
+    memory_barrier();
+    kernel_ctx = outer_ctx;
+    swap_trap_stack(outer_trap_stack);
+
+    // Free resources for the process if it exited. An exited thread stays a
+    // zombie holding its exit value until joined (or its process exits); a
+    // thread that took its process down with it (scheduler_kill_current)
+    // has its leader reaped, which reaps the thread too.
+    if (p->state == PROC_ZOMBIE) {
+        Process* leader = pid_to_proc(p->tgid);
+        if (leader && leader != p && leader->state == PROC_ZOMBIE) reap(leader);
+        else if (p->pid != p->tgid) wait_wake_all(&p->joiners, WAIT_OK);
+        else reap(p);
+    }
 
-    asm volatile("mv sp, %0" :: "r"(p->stack_top));
-    current = p->pid;
+    current = outer_pid;
+    Process* outer = pid_to_proc(outer_pid);
+    vdso_switch(outer ? outer->pid : 0, outer ? outer->tgid : 0);
+}
 
-    p->state = PROC_RUNNING;
-    memory_barrier();
-    
-    p->entry();  // either returns, or triggers ecall + trap
+extern "C" void scheduler_exit_current(int64_t value) {
+    Process* p = pid_to_proc(current);
+    if (p) p->exit_value = value;
+    terminate_process(current);
+    if (kernel_ctx) context_restore(kernel_ctx);
+    while (1) asm volatile("wfi");  // no kernel context: nothing to return to
+}
 
-    scheduler_process_return();
+void scheduler_yield_current() {
+    Process* p = pid_to_proc(current);
+    if (!p || !p->tf || !kernel_ctx) return;
+
+    p->state = PROC_READY;
+    p->restart_syscall = false;
+    p->wake_result = WAIT_OK;
+    switch_pending = true;
 }
 
-extern "C" void scheduler_process_return() {
-    // Restore kernel stack
-    asm volatile("mv sp, %0" :: "r"(kernel_saved_sp));
-    memory_barrier();
+void scheduler_kill_current() {
+    Process* p = pid_to_proc(current);
+    Process* leader = p ? pid_to_proc(p->tgid) : nullptr;
+
+    // A leader on the call chain cannot be reaped; only the thread goes then
+    if (leader && leader != p && leader->state != PROC_RUNNING) {
+        if (leader->state == PROC_BLOCKED) wait_wake(leader, WAIT_DESTROYED);
+        leader->state = PROC_ZOMBIE;
+    }
+    scheduler_exit_current(-1);
+}
 
-    // Free resources for previous process if zombie
+bool scheduler_switch_pending() {
+    return switch_pending;
+}
+
+// The frame is complete now. It stays where it is, on the process's own
+// kernel stack, until resume_process returns through it.
+extern "C" void scheduler_switch_out(TrapFrame* tf) {
     Process* p = pid_to_proc(current);
-    if (p && p->state == PROC_ZOMBIE) {
-        p->state = PROC_FREE;
-        p->pid = 0;
-        p->entry = nullptr;
-        p->name = nullptr;
-        p->stack = nullptr;
-        p->stack_top = nullptr;
-        p->stack_size = 0;
-        p->blocked_sem_id = -1;
-        p->next_blocked = nullptr;
+    switch_pending = false;
+    if (p) p->tf = tf;
+    context_restore(kernel_ctx);
+}
+
+// ---------------------------------------------------------------------
+// Wait queues
+// ---------------------------------------------------------------------
+void wait_queue_init(WaitQueue* q) {
+    q->head = nullptr;
+    q->tail = nullptr;
+}
+
+static void wait_unlink(Process* p) {
+    WaitQueue* q = p->wait_queue;
+    if (!q) return;
+
+    if (p->wait_prev) p->wait_prev->wait_next = p->wait_next;
+    else q->head = p->wait_next;
+    if (p->wait_next) p->wait_next->wait_prev = p->wait_prev;
+    else q->tail = p->wait_prev;
+
+    p->wait_queue = nullptr;
+    p->wait_prev = nullptr;
+    p->wait_next = nullptr;
+}
+
+bool wait_block(WaitQueue* q, BlockReason reason, uint64_t timeout_ticks, bool restart) {
+    Process* p = pid_to_proc(current);
+    if (!p || !p->tf || !kernel_ctx) return false;  // only a process inside a syscall can wait
+
+    p->state = PROC_BLOCKED;
+    p->block_reason = reason;
+    p->restart_syscall = restart;
+    p->wake_result = WAIT_OK;
+    p->wake_at = 0;
+    if (timeout_ticks) {
+        p->wake_at = timer_now() + timeout_ticks;
+        timed_waiters++;
     }
 
-    current = -1;
+    if (q) wait_requeue(p, q, reason);
+
+    switch_pending = true;
+    return true;
 }
 
-// Block a process on a semaphore and add to blocked list
-static void block_on_semaphore(Process* p, int sem_id) {
-    Semaphore* sem = sem_get(sem_id);
-    if (!sem) {
-        return;
+void wait_wake(Process* p, int64_t result) {
+    if (!p || p->state != PROC_BLOCKED) return;
+
+    WaitQueue* q = p->wait_queue;
+    bool mutex_waiter = p->block_reason == BLOCK_MUTEX;
+    wait_unlink(p);
+    if (p->wake_at) {
+        p->wake_at = 0;
+        timed_waiters--;
     }
+    p->block_reason = BLOCK_NONE;
+    p->wake_result = result;
+    p->state = PROC_READY;
 
-    p->state = PROC_BLOCKED_SEM;
-    p->blocked_sem_id = sem_id;
-    p->next_blocked = sem->blocked_list;
-    sem->blocked_list = p;
+    // Whoever p boosted through priority inheritance drops back
+    if (mutex_waiter && q) sync_waiter_left(q);
 }
 
-// Wake one blocked process from a semaphore
-static void wake_one_from_semaphore(int sem_id) {
-    Semaphore* sem = sem_get(sem_id);
-    if (!sem || !sem->blocked_list) {
-        return;
+void wait_requeue(Process* p, WaitQueue* q, BlockReason reason) {
+    if (!p || p->state != PROC_BLOCKED) return;
+
+    wait_unlink(p);
+    p->block_reason = reason;
+    p->wait_queue = q;
+    p->wait_prev = q->tail;
+    p->wait_next = nullptr;
+    if (q->tail) q->tail->wait_next = p;
+    else q->head = p;
+    q->tail = p;
+}
+
+Process* wait_wake_one(WaitQueue* q, int64_t result) {
+    Process* p = q->head;
+    if (p) wait_wake(p, result);
+    return p;
+}
+
+int wait_wake_all(WaitQueue* q, int64_t result) {
+    int n = 0;
+    while (q->head) {
+        wait_wake(q->head, result);
+        n++;
     }
+    return n;
+}
 
-    // Wake the first blocked process
-    Process* p = sem->blocked_list;
-    sem->blocked_list = p->next_blocked;
-    p->next_blocked = nullptr;
-    p->state = PROC_READY;
-    p->blocked_sem_id = -1;
+// Wake every waiter whose deadline has passed; a finished sleep is a success
+static void wake_expired() {
+    if (timed_waiters == 0) return;
+
+    uint64_t now = timer_now();
+    for (int i = 0; i < MAX_PROCS; ++i) {
+        Process* p = &proc_table[i];
+        if (p->state != PROC_BLOCKED || p->wake_at == 0 || now < p->wake_at) continue;
+        wait_wake(p, p->block_reason == BLOCK_SLEEP ? WAIT_OK : WAIT_TIMEOUT);
+    }
 }
 
 // ---------------------------------------------------------------------
 // Public API - Process Management
 // ---------------------------------------------------------------------
 bool scheduler_init() {
+    vdso_init();
+    proc_table.init();
+    sem_table.init();
     for (int i = 0; i < MAX_PROCS; ++i) {
         proc_table[i].pid = 0;
+        proc_table[i].tgid = 0;
         proc_table[i].name = nullptr;
         proc_table[i].entry = nullptr;
+        proc_table[i].code = nullptr;
         proc_table[i].stack = nullptr;
         proc_table[i].stack_top = nullptr;
         proc_table[i].stack_size = 0;
         proc_table[i].state = PROC_FREE;
-        proc_table[i].blocked_sem_id = -1;
-        proc_table[i].next_blocked = nullptr;
+        reset_wait_state(&proc_table[i]);
+        for (int f = 0; f < MAX_FDS; ++f) proc_table[i].fds[f] = { FD_NONE, nullptr, nullptr };
     }
 
     for (int i = 0; i < MAX_SEMS; ++i) {
         sem_table[i].id = 0;
         sem_table[i].value = 0;
         sem_table[i].owner_pid = 0;
-        sem_table[i].blocked_list = nullptr;
+        wait_queue_init(&sem_table[i].waiters);
         sem_table[i].in_use = false;
     }
 
+    kernel_ctx = nullptr;
+    timed_waiters = 0;
+    io_init();
+    pipe_init();
+    sync_init();
+
+    kmem_register_reclaim(reclaim_zombie_stacks);
+    kmem_register_reclaim(oom_kill);  // last: only once nothing else helps
+
     next_pid = 1;
     next_sem_id = 1;
     current = -1;
     return true;
 }
 
-int create_process(void (*entry)(), const char* name, uint32_t stack_size) {
+// Process creation is all or nothing: the slot and every allocation are
+// reserved first, and a failure releases whatever was already taken
+static Process* reserve_process(uint64_t code_size, uint32_t stack_size) {
     Process* slot = find_free_slot();
-    if (!slot) {
-        return -1;
+    if (!slot) return nullptr;
+
+    ProcessMemory mem = alloc_process_memory(code_size, stack_size, KERNEL_STACK_SIZE);
+    if (!mem.stack) {
+        proc_table.free(slot);
+        return nullptr;
     }
 
-    int slot_idx = slot - proc_table;
+    slot->code = mem.code;
+    slot->stack = mem.stack;
+    slot->stack_size = stack_size;
+    slot->stack_top = (uint8_t*)((uintptr_t)(slot->stack + stack_size) & ~0xFULL);
+    slot->kstack = mem.kstack;
+    slot->kstack_top = (uint8_t*)((uintptr_t)(slot->kstack + KERNEL_STACK_SIZE) & ~0xFULL);
+    slot->emu_misaligned = 0;
+    slot->emu_insns = 0;
+    return slot;
+}
 
-    void* stk = kmalloc(stack_size);
-    if (!stk) {
-        return -1;
-    }
+// Nothing here can fail: give the reserved slot an identity and make it ready
+static int commit_process(Process* slot, void (*entry)(), const char* name) {
+    int slot_idx = proc_table.index_of(slot);
 
     slot->pid = next_pid++;
+    slot->tgid = slot->pid;
     slot->entry = entry;
-    slot->stack = (uint8_t*)stk;
-    slot->stack_size = stack_size;
-    slot->stack_top = slot->stack + slot->stack_size;
-    slot->stack_top = (uint8_t*)((uintptr_t)slot->stack_top & ~0xFULL);
-    slot->blocked_sem_id = -1;
-    slot->next_blocked = nullptr;
+    reset_wait_state(slot);
+    release_fds(slot);
 
-    const char* src = name ? name : "proc";
     int j = 0;
-    while (src[j] && j < (int)sizeof(proc_name_buf[0]) - 1) {
-        proc_name_buf[slot_idx][j] = src[j];
+    while (name[j] && j < (int)sizeof(proc_name_buf[0]) - 1) {
+        proc_name_buf[slot_idx][j] = name[j];
         j++;
     }
     proc_name_buf[slot_idx][j] = '\0';
@@ -220,99 +486,219 @@ int create_process(void (*entry)(), const char* name, uint32_t stack_size) {
     return slot->pid;
 }
 
-int create_process_from_binary(const uint8_t* binary, uint32_t binary_size,
-                                const char* name, uint32_t stack_size) {
-    Process* slot = find_free_slot();
+int create_process(void (*entry)(), const char* name, uint32_t stack_size) {
+    Process* slot = reserve_process(0, stack_size);
     if (!slot) {
+        print_str("(scheduler) Failed to create process: out of slots or memory\n");
         return -1;
     }
+    return commit_process(slot, entry, name ? name : "proc");
+}
 
-    int slot_idx = slot - proc_table;
-
+int create_process_from_binary(const uint8_t* binary, uint32_t binary_size,
+                                const char* name, uint32_t stack_size) {
     uint32_t code_size = (binary_size + 15) & ~15ULL;
-    void* code_mem = kmalloc(code_size);
-    if (!code_mem) {
-        print_str("(scheduler) Failed to allocate code memory\n");
+    Process* slot = reserve_process(code_size, stack_size);
+    if (!slot) {
+        print_str("(scheduler) Failed to create process: out of slots or memory\n");
         return -1;
     }
 
-    void* stack_mem = kmalloc(stack_size);
-    if (!stack_mem) {
-        print_str("(scheduler) Failed to allocate stack memory\n");
-        return -1;
-    }
+    memcpy(slot->code, binary, binary_size);
+    return commit_process(slot, (void(*)())slot->code, name ? name : "userproc");
+}
 
-    memcpy(code_mem, binary, binary_size);
+void schedule_yield() {
+    asm volatile("nop");
+}
 
-    slot->pid = next_pid++;
-    slot->entry = (void(*)())code_mem;
-    slot->stack = (uint8_t*)stack_mem;
-    slot->stack_size = stack_size;
-    slot->stack_top = slot->stack + slot->stack_size;
-    slot->stack_top = (uint8_t*)((uintptr_t)slot->stack_top & ~0xFULL);
-    slot->blocked_sem_id = -1;
-    slot->next_blocked = nullptr;
+int scheduler_proc_count() {
+    return proc_table.used();
+}
 
-    const char* src = name ? name : "userproc";
-    int j = 0;
-    while (src[j] && j < (int)sizeof(proc_name_buf[0]) - 1) {
-        proc_name_buf[slot_idx][j] = src[j];
-        j++;
-    }
-    proc_name_buf[slot_idx][j] = '\0';
-    slot->name = proc_name_buf[slot_idx];
+Process* scheduler_get_process_table() {
+    return proc_table.data();
+}
 
-    slot->state = PROC_READY;
+int scheduler_get_max_procs() {
+    return MAX_PROCS;
+}
 
-    char pid_str[16];
-    itoa(slot->pid, pid_str, 10);
-    print_str("(scheduler) Process created for '");
-    print_str(name);
-    print_str("' [PID ");
-    print_str(pid_str);
-    print_str("].\n");
+Process* scheduler_get_proc_by_pid(int pid) {
+    return pid_to_proc(pid);
+}
+
+Process* scheduler_get_leader(int pid) {
+    Process* p = pid_to_proc(pid);
+    return p ? pid_to_proc(p->tgid) : nullptr;
+}
+
+int scheduler_current_tgid() {
+    Process* p = pid_to_proc(current);
+    return p ? p->tgid : current;
+}
+
+// ---------------------------------------------------------------------
+// Threads
+// ---------------------------------------------------------------------
+int thread_create(void (*entry)(), uint64_t arg, uint32_t stack_size) {
+    Process* leader = scheduler_get_leader(current);
+    if (!leader || !entry) return -1;
 
+    if (stack_size == 0) stack_size = DEFAULT_STACK_SIZE;
+    Process* slot = reserve_process(0, stack_size);  // no image: runs in the leader's
+    if (!slot) return -1;
+
+    slot->pid = next_pid++;
+    slot->tgid = leader->pid;
+    slot->entry = entry;
+    slot->name = leader->name;
+    reset_wait_state(slot);
+    release_fds(slot);  // threads use the leader's table
+    slot->arg = arg;
+    slot->base_priority = slot->priority = pid_to_proc(current)->base_priority;
+    slot->state = PROC_READY;
     return slot->pid;
 }
 
-void schedule_yield() {
-    asm volatile("nop");
+// Only a thread of the caller's own process, never the leader, can be joined
+int thread_join(int tid, int64_t* value_out) {
+    Process* self = pid_to_proc(current);
+    Process* t = pid_to_proc(tid);
+    if (!self || !t || t == self || t->tgid != self->tgid || t->pid == t->tgid) return -1;
+
+    if (t->state != PROC_ZOMBIE) {
+        wait_block(&t->joiners, BLOCK_JOIN, 0, true);  // re-runs the join after the exit
+        return -1;  // not inside a syscall: cannot block
+    }
+
+    if (value_out) *value_out = t->exit_value;
+    reap(t);
+    return 0;
 }
 
-int scheduler_proc_count() {
-    int cnt = 0;
+// ---------------------------------------------------------------------
+// Memory pressure (kmalloc reclaim hooks, registered in scheduler_init)
+// ---------------------------------------------------------------------
+
+// An exited thread keeps its slot and exit value until joined, but its
+// stacks are dead: free them
+static bool reclaim_zombie_stacks(uint64_t wanted) {
+    (void)wanted;
+    bool freed = false;
     for (int i = 0; i < MAX_PROCS; ++i) {
-        if (proc_table[i].state != PROC_FREE) ++cnt;
+        Process* p = &proc_table[i];
+        if (p->state != PROC_ZOMBIE || !p->stack) continue;
+        kfree(p->stack);
+        kfree(p->kstack);
+        p->stack = nullptr;
+        p->stack_top = nullptr;
+        p->kstack = nullptr;
+        p->kstack_top = nullptr;
+        freed = true;
     }
-    return cnt;
+    return freed;
 }
 
-Process* scheduler_get_process_table() {
-    return proc_table;
+// Heap bytes held by a thread group: its image plus every member's stacks.
+// Groups with a running member are on the call chain and cannot be killed.
+static uint64_t group_footprint(Process* leader) {
+    uint64_t bytes = kmem_size(leader->code);
+    for (int i = 0; i < MAX_PROCS; ++i) {
+        Process* t = &proc_table[i];
+        if (t->state == PROC_FREE || t->tgid != leader->pid) continue;
+        if (t->state == PROC_RUNNING) return 0;
+        bytes += kmem_size(t->stack) + kmem_size(t->kstack);
+    }
+    return bytes;
 }
 
-int scheduler_get_max_procs() {
-    return MAX_PROCS;
+// Last resort: kill the user program holding the most memory. Kernel
+// processes (the shell) have no loaded image and are never chosen.
+static bool oom_kill(uint64_t wanted) {
+    (void)wanted;
+    Process* victim = nullptr;
+    uint64_t victim_bytes = 0;
+
+    for (int i = 0; i < MAX_PROCS; ++i) {
+        Process* p = &proc_table[i];
+        if (p->state == PROC_FREE || p->tgid != p->pid || !p->code) continue;
+        uint64_t bytes = group_footprint(p);
+        if (bytes > victim_bytes) {
+            victim = p;
+            victim_bytes = bytes;
+        }
+    }
+    if (!victim) return false;
+
+    char buf[16];
+    print_str("(memory) Out of memory: killing PID ");
+    itoa(victim->pid, buf, 10);
+    print_str(buf);
+    print_str(" '");
+    print_str(victim->name);
+    print_str("' (");
+    itoa((uint32_t)(victim_bytes / 1024), buf, 10);
+    print_str(buf);
+    print_str(" KB)\n");
+    return scheduler_kill(victim->pid) == 0;
 }
 
-Process* scheduler_get_proc_by_pid(int pid) {
-    return pid_to_proc(pid);
+// Kill a process that is not currently executing. A blocked one is taken
+// off its wait queue first; either way its resources are released at once.
+int scheduler_kill(int pid) {
+    Process* p = pid_to_proc(pid);
+    if (!p || p->state == PROC_FREE) return -1;
+    if (p->state == PROC_RUNNING) return -1;  // on the call chain (e.g. the shell)
+
+    if (p->state == PROC_BLOCKED) wait_wake(p, WAIT_DESTROYED);
+    p->state = PROC_ZOMBIE;
+    reap(p);
+    return 0;
+}
+
+// Effective priority never drops below what waiters on held mutexes lend
+int scheduler_set_priority(int pid, int priority) {
+    Process* p = pid_to_proc(pid);
+    if (!p || priority < PRIO_LOW || priority > PRIO_MAX) return -1;
+
+    p->base_priority = priority;
+    int inherited = sync_inherited_priority(pid);
+    p->priority = inherited > priority ? inherited : priority;
+    return 0;
 }
 
 int scheduler_run_pid(int pid) {
     Process *p = pid_to_proc(pid);
-    if (!p) return -1;
+    if (!p || p->state != PROC_READY) return -1;
     run_process(p);
     return 0;
 }
 
+bool scheduler_poll() {
+    static int start_idx = 0;
+
+    // Start queued I/O, expire timeouts, and hand console input to readers
+    vdso_update_clock();
+    io_service();
+    wake_expired();
+    if (console_waiters.head && console_has_input()) wait_wake_all(&console_waiters, WAIT_OK);
+
+    Process* next = find_next_ready(start_idx);
+    if (!next) return false;
+
+    start_idx = (proc_table.index_of(next) + 1) % MAX_PROCS;
+    run_process(next);
+    return true;
+}
+
 // ---------------------------------------------------------------------
 // Public API - Semaphore Management
 // Note: In cooperative multitasking, we don't need locks around these
 // because processes only yield at explicit points (ecall)
 // ---------------------------------------------------------------------
 int sem_create(int initial_value) {
-    Semaphore* slot = find_free_sem_slot();
+    Semaphore* slot = sem_table.alloc();
     if (!slot) {
         return -1;
     }
@@ -320,36 +706,28 @@ int sem_create(int initial_value) {
     int sem_id = next_sem_id++;
     slot->id = sem_id;
     slot->value = initial_value;
-    slot->owner_pid = current;
-    slot->blocked_list = nullptr;
+    slot->owner_pid = scheduler_current_tgid();
+    wait_queue_init(&slot->waiters);
     slot->in_use = true;
 
     return sem_id;
 }
 
-void sem_wait(int sem_id) {
+// The count never goes negative: a waiter that finds it zero blocks and
+// re-runs sem_wait when signalled, so a timed-out waiter leaves nothing to undo
+int sem_wait(int sem_id, uint64_t timeout_ms) {
     Semaphore* sem = sem_get(sem_id);
     if (!sem) {
-        return;
+        return -1;
     }
 
-    sem->value--;
-
-    if (sem->value < 0) {
-        // Block this process
-        Process* p = pid_to_proc(current);
-        if (p) {
-            p->state = PROC_BLOCKED_SEM;
-            p->blocked_sem_id = sem_id;
-            p->next_blocked = sem->blocked_list;
-            sem->blocked_list = p;
-        }
-        
-        // Jump back to scheduler
-        asm volatile("mv sp, %0" :: "r"(kernel_saved_sp));
-        asm volatile("jr %0" :: "r"(kernel_resume_pc));
-        // Never reaches here
+    if (sem->value > 0) {
+        sem->value--;
+        return 0;
     }
+
+    wait_block(&sem->waiters, BLOCK_SEM, timeout_ms * TIMER_TICKS_PER_MS, true);
+    return -1;  // not inside a syscall: cannot block
 }
 
 void sem_signal(int sem_id) {
@@ -359,24 +737,19 @@ void sem_signal(int sem_id) {
     }
 
     sem->value++;
-
-    // If there are blocked processes, wake one
-    if (sem->value <= 0 && sem->blocked_list) {
-        Process* p = sem->blocked_list;
-        sem->blocked_list = p->next_blocked;
-        p->next_blocked = nullptr;
-        p->state = PROC_READY;
-        p->blocked_sem_id = -1;
-    }
+    wait_wake_one(&sem->waiters, WAIT_OK);
 }
 
+// Blocked waiters return WAIT_DESTROYED from sem_wait
 bool sem_destroy(int sem_id) {
     for (int i = 0; i < MAX_SEMS; ++i) {
         if (sem_table[i].id == sem_id && sem_table[i].in_use) {
+            wait_wake_all(&sem_table[i].waiters, WAIT_DESTROYED);
             sem_table[i].in_use = false;
             sem_table[i].id = 0;
             sem_table[i].value = 0;
-            sem_table[i].blocked_list = nullptr;
+            sem_table[i].owner_pid = 0;
+            sem_table.free(&sem_table[i]);
             return true;
         }
     }
@@ -400,32 +773,95 @@ void scheduler_main() {
 
     scheduler_init();
 
-    bool has_any = false;
-    for (int i = 0; i < MAX_PROCS; ++i) {
-        if (proc_table[i].state != PROC_FREE) {
-            has_any = true;
-            break;
-        }
-    }
-    if (!has_any) {
+    if (proc_table.used() == 0) {
         int pid = create_process((void(*)())shell_main, "shell", DEFAULT_STACK_SIZE);
         if (pid < 0) {
             print_str("(scheduler) Failed to create shell process...\n");
+        } else {
+            // Interactive work must not queue behind batch programs
+            scheduler_set_priority(pid, PRIO_HIGH);
         }
     }
 
-    int start_idx = 0;
-
     while (1) {
-        Process* next = find_next_ready(start_idx);
-        
-        if (next) {
-            int next_idx = next - proc_table;
-            start_idx = (next_idx + 1) % MAX_PROCS;
-            run_process(next);
+        // No ready processes: idle until an interrupt (or the next deadline)
+        if (!scheduler_poll() && timed_waiters == 0) asm volatile("wfi");
+    }
+}
+
+// ---------------------------------------------------------------------
+// Shell commands (registered through SCHEDULER_COMMANDS)
+// ---------------------------------------------------------------------
+void cmd_kill(const char* args) {
+    int pid = 0;
+    for (const char* c = args; c && *c >= '0' && *c <= '9'; ++c) pid = pid * 10 + (*c - '0');
+
+    if (pid <= 0) {
+        shell_fail("Usage: kill <pid>\n");
+        return;
+    }
+    if (scheduler_kill(pid) < 0) {
+        shell_fail("kill: no such process, or it is running\n");
+        return;
+    }
+    print_str("(scheduler) Killed process.\n");
+}
+
+void cmd_ps(const char* args) {
+    (void)args;
+    Process* table = scheduler_get_process_table();
+    int max = scheduler_get_max_procs();
+
+    print_str("PID\tName\t\tPri\tState\n");
+    print_str("---------------------------------------\n");
+
+    for (int i = 0; i < max; ++i) {
+        Process* p = &table[i];
+        if (p->state == PROC_FREE) continue;
+
+        // PID
+        char buf[8];
+        itoa(p->pid, buf, 10);
+        print_str(buf);
+        print_str("\t");
+
+        // Name
+        if (p->name) {
+            print_str(p->name);
+
+            int len = strlen(p->name);
+
+            if (len < 8)
+                print_str("\t\t");   // short name → more spacing
+            else
+                print_str("\t");     // long name → single tab
         } else {
-            // No ready processes: idle
-            asm volatile("wfi");
+            print_str("(no name)\t");
+        }
+
+        // Effective priority, with the base in brackets while boosted
+        itoa(p->priority, buf, 10);
+        print_str(buf);
+        if (p->priority != p->base_priority) {
+            print_str("(");
+            itoa(p->base_priority, buf, 10);
+            print_str(buf);
+            print_str(")");
+        }
+        print_str("\t");
+
+        // State
+        static const char* const reasons[] = { "", " (sem)", " (io)", " (pipe)", " (uart)", " (sleep)", " (mutex)", " (cond)", " (join)", " (futex)" };
+        switch (p->state) {
+            case PROC_READY:   print_str("READY"); break;
+            case PROC_RUNNING: print_str("RUNNING"); break;
+            case PROC_BLOCKED:
+                print_str("BLOCKED");
+                print_str(reasons[p->block_reason]);
+                break;
+            case PROC_ZOMBIE:  print_str("ZOMBIE"); break;
+            default:           print_str("UNKNOWN"); break;
         }
+        print_str("\n");
     }
 }
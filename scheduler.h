@@ -6,39 +6,156 @@ Description: Scheduler API definitions including process structures, states, tra
 
 #pragma once
 #include <stdint.h>
+#include "pool.h"
 
 #define MAX_PROCS 16
 #define MAX_SEMS 32
 #define DEFAULT_STACK_SIZE 4096
+#define KERNEL_STACK_SIZE 8192  // per process, for its traps
+#define MAX_FDS 8
 
+// Scheduling priorities: the highest-priority ready process runs first
+#define PRIO_LOW 0
+#define PRIO_NORMAL 4
+#define PRIO_HIGH 8
+#define PRIO_MAX 15
+
+#define SYSCALL_DUP2 24
+#define SYSCALL_OPEN 56
+#define SYSCALL_CLOSE 57
+#define SYSCALL_PIPE 59
+#define SYSCALL_LSEEK 62
+#define SYSCALL_READ 63
+#define SYSCALL_WRITE 64
 #define SYSCALL_EXIT 93
+#define SYSCALL_SLEEP 101
 #define SYSCALL_YIELD 124
+#define SYSCALL_SETPRIORITY 140
 #define SYSCALL_SEM_CREATE 150
 #define SYSCALL_SEM_WAIT 151
 #define SYSCALL_SEM_SIGNAL 152
 #define SYSCALL_SEM_DESTROY 153
+#define SYSCALL_SEM_TIMEDWAIT 154
+#define SYSCALL_IO_SUBMIT 160
+#define SYSCALL_IO_WAIT 161
+#define SYSCALL_REGEX_SEARCH 170
+#define SYSCALL_GETPID 172
+#define SYSCALL_THREAD_CREATE 190
+#define SYSCALL_THREAD_EXIT 191
+#define SYSCALL_THREAD_JOIN 192
+
+// Results delivered to a woken process (returned from its blocking syscall)
+#define WAIT_OK 0
+#define WAIT_TIMEOUT -2
+#define WAIT_DESTROYED -3  // the object waited on went away
 
 // Process states
 enum ProcState {
     PROC_FREE,
     PROC_READY,
     PROC_RUNNING,
-    PROC_BLOCKED_SEM,  // blocked on semaphore
-    PROC_SLEEP,
+    PROC_BLOCKED,  // waiting; see block_reason
     PROC_ZOMBIE
 };
 
-// Process control block
+// Why a PROC_BLOCKED process is waiting (shown by ps)
+enum BlockReason {
+    BLOCK_NONE,
+    BLOCK_SEM,    // semaphore
+    BLOCK_IO,     // I/O completions
+    BLOCK_PIPE,   // pipe data or space
+    BLOCK_UART,   // console input
+    BLOCK_SLEEP,  // timed sleep
+    BLOCK_MUTEX,  // mutex held by another process
+    BLOCK_COND,   // condition variable
+    BLOCK_JOIN,   // waiting for a thread to exit
+    BLOCK_FUTEX   // futex_wait on a user address
+};
+
+struct Process;
+
+// Intrusive FIFO of blocked processes. A process waits on at most one queue,
+// so the links live in the Process and enqueue/remove are O(1).
+struct WaitQueue {
+    Process* head;
+    Process* tail;
+};
+
+struct OpenFile;
+struct Pipe;
+
+// What a descriptor refers to
+enum FdKind {
+    FD_NONE,
+    FD_FILE,
+    FD_PIPE_READ,
+    FD_PIPE_WRITE
+};
+
+struct FileDesc {
+    FdKind kind;
+    OpenFile* file;  // FD_FILE
+    Pipe* pipe;      // FD_PIPE_READ / FD_PIPE_WRITE
+};
+
+// Register frame pushed by trap_vector onto the process's kernel stack
+// (layout must match trap.S). On the syscall fast path gp, tp and s0-s11 are
+// filled in only if the process is switched out; exceptions always get a
+// complete frame.
+struct TrapFrame {
+    uint64_t ra, gp, tp;
+    uint64_t t0, t1, t2, t3, t4, t5, t6;
+    uint64_t s0, s1, s2, s3, s4, s5, s6, s7, s8, s9, s10, s11;
+    uint64_t a0, a1, a2, a3, a4, a5, a6, a7;
+    uint64_t sp;       // interrupted stack pointer
+    uint64_t epc;      // mepc; written back on return
+    uint64_t scratch;  // mscratch to restore on return
+    uint64_t cause;    // mcause
+};
+static_assert(sizeof(TrapFrame) == 272, "TrapFrame must match TF_SIZE in trap.S");
+
+// Process control block. A thread is a Process whose tgid names another
+// entry, its group leader: it has its own stack and saved context but uses
+// the leader's descriptors, and objects it creates belong to the leader.
 struct Process {
     int pid;
+    int tgid;               // thread group (leader's pid; == pid for a process)
     const char* name;
     void (*entry)();
+    uint8_t* code;       // loaded program image, freed on exit (nullptr if none)
     uint8_t* stack;
     uint8_t* stack_top;  // pointer to top of stack
     uint32_t stack_size;
+    uint8_t* kstack;     // trap stack, found through mscratch while it runs
+    uint8_t* kstack_top;
     ProcState state;
-    int blocked_sem_id;  // which semaphore it's blocked on
-    Process* next_blocked;  // linked list of blocked processes
+    int base_priority;      // as set by setpriority
+    int priority;           // effective; raised by priority inheritance
+    FileDesc fds[MAX_FDS];  // open files and pipe ends, indexed by descriptor
+
+    // Saved user context while inside a syscall, and after it stopped there
+    // (blocked or yielded); the frame stays on the kernel stack meanwhile
+    TrapFrame* tf;          // frame on kstack, nullptr if none
+    uint64_t resume_pc;     // address of the ecall
+    bool restart_syscall;   // on WAIT_OK re-run the ecall instead of returning
+
+    // Wait-queue linkage
+    BlockReason block_reason;
+    WaitQueue* wait_queue;  // queue it is linked into, if any
+    Process* wait_prev;
+    Process* wait_next;
+    uint64_t wake_at;       // timeout deadline in timer ticks, 0 = none
+    int64_t wake_result;    // WAIT_OK, WAIT_TIMEOUT, or a waker's error code
+
+    // Threads
+    uint64_t arg;           // passed to the entry point in a0
+    int64_t exit_value;     // kept in the zombie until a thread is joined
+    WaitQueue joiners;      // blocked in thread_join on this thread
+    uint64_t futex_addr;    // address passed to futex_wait while parked
+
+    // Traps emulated on its behalf (see emulate.h)
+    uint32_t emu_misaligned;
+    uint32_t emu_insns;
 };
 
 // Semaphore structure
@@ -46,15 +163,13 @@ struct Semaphore {
     int id;
     int value;
     int owner_pid;  // PID that created it
-    Process* blocked_list;  // head of linked list of blocked processes
+    WaitQueue waiters;  // processes blocked in sem_wait
     bool in_use;
 };
 
 // Global process table
-extern Process proc_table[MAX_PROCS];
+extern ObjectPool<Process, MAX_PROCS> proc_table;  // slots scanned by index; free ones are PROC_FREE
 extern int current;
-extern uintptr_t kernel_saved_sp;
-extern uintptr_t kernel_resume_pc;
 
 // Process management
 bool scheduler_init();
@@ -66,18 +181,66 @@ int scheduler_proc_count();
 Process* scheduler_get_process_table();
 int scheduler_get_max_procs();
 Process* scheduler_get_proc_by_pid(int pid);
+Process* scheduler_get_leader(int pid);  // the process a thread belongs to
+int scheduler_current_tgid();
 int scheduler_run_pid(int pid);
 void terminate_process(int pid);
+int scheduler_set_priority(int pid, int priority);
+int scheduler_kill(int pid);
+void fd_release(FileDesc* fd);
 void scheduler_main();
 
+// Run pending kernel work and at most one ready process; called from the
+// scheduler loop and whenever the shell is idle. Returns true if a process ran.
+bool scheduler_poll();
+
+// Leave the current process's syscall and return to the kernel context
+// that ran it. exit marks it a zombie and leaves at once; yield keeps it
+// ready and, like a successful wait_block, takes effect when the syscall
+// handler returns (see scheduler_switch_pending).
+extern "C" void scheduler_exit_current(int64_t value);
+void scheduler_yield_current();
+
+// End the current process after a fault: the whole thread group goes, not
+// just the faulting thread. Does not return.
+void scheduler_kill_current();
+
+// The current syscall stopped (blocked or yielded): trap_vector completes
+// the frame and calls scheduler_switch_out instead of returning to it, which
+// leaves the frame on the process's kernel stack and switches away
+bool scheduler_switch_pending();
+extern "C" void scheduler_switch_out(TrapFrame* tf) __attribute__((noreturn));
+
+// Wait queues
+void wait_queue_init(WaitQueue* q);
+
+// Block the current process (inside a syscall) on q, which may be nullptr for
+// a pure sleep. timeout_ticks = 0 waits forever. With restart set the ecall
+// is re-executed after a WAIT_OK wakeup, so the syscall can retry; otherwise
+// the syscall returns wake_result. Returns true once blocked: the caller
+// should return straight away, its result is ignored and the switch happens
+// when the handler returns. Returns false if nothing could be blocked.
+bool wait_block(WaitQueue* q, BlockReason reason, uint64_t timeout_ticks, bool restart);
+void wait_wake(Process* p, int64_t result);
+void wait_requeue(Process* p, WaitQueue* q, BlockReason reason);  // move, still blocked
+Process* wait_wake_one(WaitQueue* q, int64_t result);
+int wait_wake_all(WaitQueue* q, int64_t result);
+
+// Threads (syscalls). thread_join blocks until the thread exits, stores its
+// exit value through value_out (if non-null) and frees the thread.
+int thread_create(void (*entry)(), uint64_t arg, uint32_t stack_size);
+int thread_join(int tid, int64_t* value_out);
+
 // Semaphore management
 int sem_create(int initial_value);
-void sem_wait(int sem_id);
+int sem_wait(int sem_id, uint64_t timeout_ms = 0);
 void sem_signal(int sem_id);
 bool sem_destroy(int sem_id);
 Semaphore* sem_get(int sem_id);
 
-// Context switching
-extern "C" void scheduler_process_return();
+// Shell commands provided by the scheduler (see commands.h)
+#define SCHEDULER_COMMANDS(CMD) \
+    CMD("ps", cmd_ps, "'ps'\t\tDisplay all currently running processes.") \
+    CMD("kill", cmd_kill, "'kill <pid>'\tTerminate a process and release its resources.")
 
 #endif
@@ -0,0 +1,245 @@
+/* Copyright (c) 2025, Rye Stahle-Smith
+December 2nd, 2025 - search.cpp
+Description: Word-at-a-time byte scanning, a small backtracking regular expression engine, and line-oriented grep used by the shell and the search syscall. */
+#include "search.h"
+#include "shell.h"
+
+// ---------------------------------------------------------------------
+// Word-at-a-time byte search
+// XOR each 8-byte word with the target byte repeated; a lane becomes zero
+// exactly where the byte matches, and (x - 0x01..) & ~x & 0x80.. is nonzero
+// iff some lane is zero. Only the word containing a hit is scanned bytewise.
+// ---------------------------------------------------------------------
+typedef uint64_t __attribute__((may_alias)) word_t;
+
+static const uint64_t ONES = 0x0101010101010101ULL;
+static const uint64_t HIGHS = 0x8080808080808080ULL;
+
+const uint8_t* find_byte(const uint8_t* s, int len, uint8_t c) {
+    const uint8_t* end = s + len;
+
+    // Step bytewise up to an 8-byte boundary
+    while (s < end && ((uintptr_t)s & 7)) {
+        if (*s == c) return s;
+        s++;
+    }
+
+    uint64_t pattern = ONES * c;
+    while (end - s >= 8) {
+        uint64_t x = *(const word_t*)s ^ pattern;
+        if ((x - ONES) & ~x & HIGHS) break;  // hit somewhere in this word
+        s += 8;
+    }
+
+    while (s < end) {
+        if (*s == c) return s;
+        s++;
+    }
+    return nullptr;
+}
+
+// ---------------------------------------------------------------------
+// Regex compilation
+// Supports literals, '.', '[set]', '[^set]', ranges, '\' escapes, the
+// postfix operators '*', '+', '?', and the anchors '^' and '$'.
+// ---------------------------------------------------------------------
+static void class_set(uint8_t* cls, uint8_t c) { cls[c >> 3] |= (uint8_t)(1 << (c & 7)); }
+static bool class_has(const uint8_t* cls, uint8_t c) { return cls[c >> 3] & (1 << (c & 7)); }
+
+// Parse "[...]" starting after the '['; returns the position past ']'
+static const char* compile_class(RegexToken* t, const char* p) {
+    bool negate = false;
+    if (*p == '^') {
+        negate = true;
+        p++;
+    }
+
+    memset(t->cls, 0, sizeof(t->cls));
+    bool first = true;  // a leading ']' is a literal member
+    while (*p && (*p != ']' || first)) {
+        uint8_t lo = (uint8_t)*p++;
+        if (lo == '\\' && *p) lo = (uint8_t)*p++;
+
+        uint8_t hi = lo;
+        if (*p == '-' && p[1] && p[1] != ']') {
+            p++;
+            hi = (uint8_t)*p++;
+            if (hi == '\\' && *p) hi = (uint8_t)*p++;
+        }
+        for (int c = lo; c <= hi; c++) class_set(t->cls, (uint8_t)c);
+        first = false;
+    }
+    if (*p != ']') return nullptr;  // unterminated set
+
+    if (negate) {
+        for (int i = 0; i < (int)sizeof(t->cls); i++) t->cls[i] = ~t->cls[i];
+    }
+    t->kind = RE_CLASS;
+    return p + 1;
+}
+
+bool regex_compile(Regex* re, const char* p) {
+    re->ntok = 0;
+    re->anchor_start = false;
+    re->anchor_end = false;
+    re->literal = true;
+
+    if (*p == '^') {
+        re->anchor_start = true;
+        p++;
+    }
+
+    while (*p) {
+        if (*p == '$' && p[1] == '\0') {
+            re->anchor_end = true;
+            break;
+        }
+        if (re->ntok >= REGEX_MAX_TOKENS) return false;
+        if (*p == '*' || *p == '+' || *p == '?') return false;  // nothing to repeat
+
+        RegexToken* t = &re->tok[re->ntok];
+        t->quant = RE_ONE;
+
+        if (*p == '.') {
+            t->kind = RE_ANY;
+            p++;
+        } else if (*p == '[') {
+            p = compile_class(t, p + 1);
+            if (!p) return false;
+        } else {
+            if (*p == '\\' && p[1]) p++;
+            t->kind = RE_CHAR;
+            t->ch = (uint8_t)*p++;
+        }
+
+        if (*p == '*') t->quant = RE_STAR;
+        else if (*p == '+') t->quant = RE_PLUS;
+        else if (*p == '?') t->quant = RE_OPT;
+        if (t->quant != RE_ONE) p++;
+
+        if (t->kind != RE_CHAR || t->quant != RE_ONE) re->literal = false;
+        re->ntok++;
+    }
+
+    if (re->anchor_start || re->anchor_end) re->literal = false;
+    return true;
+}
+
+// ---------------------------------------------------------------------
+// Matching
+// Greedy quantifiers take as many bytes as they can and record a
+// backtrack point; on failure the most recent point gives back one byte.
+// Each quantified token owns at most one point, so the backtrack stack is
+// bounded by the token count and nothing recurses.
+// ---------------------------------------------------------------------
+static bool token_matches(const RegexToken* t, uint8_t c) {
+    if (t->kind == RE_CHAR) return c == t->ch;
+    if (t->kind == RE_ANY) return true;
+    return class_has(t->cls, c);
+}
+
+static bool match_at(const Regex* re, const uint8_t* s, int len, int start) {
+    struct Backtrack { int ti; int pos; int count; int min; };
+    Backtrack stack[REGEX_MAX_TOKENS];
+    int sp = 0;
+
+    int ti = 0;
+    int pos = start;
+
+    while (true) {
+        bool ok;
+
+        if (ti == re->ntok) {
+            if (!re->anchor_end || pos == len) return true;
+            ok = false;
+        } else {
+            const RegexToken* t = &re->tok[ti];
+
+            if (t->quant == RE_ONE) {
+                ok = pos < len && token_matches(t, s[pos]);
+                if (ok) {
+                    pos++;
+                    ti++;
+                }
+            } else {
+                int max = len - pos;
+                if (t->quant == RE_OPT && max > 1) max = 1;
+                int min = (t->quant == RE_PLUS) ? 1 : 0;
+                int n = 0;
+                while (n < max && token_matches(t, s[pos + n])) n++;
+
+                ok = n >= min;
+                if (ok) {
+                    stack[sp].ti = ti;
+                    stack[sp].pos = pos;
+                    stack[sp].count = n;
+                    stack[sp].min = min;
+                    sp++;
+                    pos += n;
+                    ti++;
+                }
+            }
+        }
+
+        if (ok) continue;
+
+        // Backtrack: shorten the latest greedy run that can still give
+        while (sp > 0 && stack[sp - 1].count == stack[sp - 1].min) sp--;
+        if (sp == 0) return false;
+
+        Backtrack* b = &stack[sp - 1];
+        b->count--;
+        ti = b->ti + 1;
+        pos = b->pos + b->count;
+    }
+}
+
+static bool literal_at(const Regex* re, const uint8_t* s, int len, int start) {
+    if (len - start < re->ntok) return false;
+    for (int i = 0; i < re->ntok; i++) {
+        if (s[start + i] != re->tok[i].ch) return false;
+    }
+    return true;
+}
+
+int regex_search(const Regex* re, const uint8_t* text, int len) {
+    if (re->anchor_start) return match_at(re, text, len, 0) ? 0 : -1;
+
+    // A leading required literal lets us skip straight to candidate bytes
+    const RegexToken* first = re->ntok > 0 ? &re->tok[0] : nullptr;
+    bool prefilter = first && first->kind == RE_CHAR &&
+                     (first->quant == RE_ONE || first->quant == RE_PLUS);
+
+    for (int pos = 0; pos <= len; pos++) {
+        if (prefilter) {
+            const uint8_t* hit = find_byte(text + pos, len - pos, first->ch);
+            if (!hit) return -1;
+            pos = (int)(hit - text);
+        }
+
+        bool found = re->literal ? literal_at(re, text, len, pos)
+                                 : match_at(re, text, len, pos);
+        if (found) return pos;
+    }
+    return -1;
+}
+
+int grep_buffer(const Regex* re, const uint8_t* data, int len, GrepMatchFn fn, void* ctx) {
+    int matches = 0;
+    int line_no = 1;
+    int pos = 0;
+
+    while (pos < len) {
+        const uint8_t* nl = find_byte(data + pos, len - pos, '\n');
+        int end = nl ? (int)(nl - data) : len;
+
+        if (regex_search(re, data + pos, end - pos) >= 0) {
+            matches++;
+            if (fn) fn(data + pos, end - pos, line_no, ctx);
+        }
+
+        pos = end + 1;
+        line_no++;
+    }
+    return matches;
+}
@@ -0,0 +1,57 @@
+/* Copyright (c) 2025, Rye Stahle-Smith
+December 2nd, 2025 - search.h
+Description: Byte and pattern search primitives: word-at-a-time byte scanning, a small regular expression engine, and line-oriented grep over buffers. */
+#ifndef SEARCH_H
+#define SEARCH_H
+
+#pragma once
+#include <stdint.h>
+
+#define REGEX_MAX_TOKENS 32
+
+// Token kinds
+enum RegexKind : uint8_t {
+    RE_CHAR,   // one literal byte
+    RE_ANY,    // '.'
+    RE_CLASS   // '[...]' or '[^...]'
+};
+
+// Repetition applied to a token
+enum RegexQuant : uint8_t {
+    RE_ONE,
+    RE_STAR,   // '*'
+    RE_PLUS,   // '+'
+    RE_OPT     // '?'
+};
+
+struct RegexToken {
+    RegexKind kind;
+    RegexQuant quant;
+    uint8_t ch;
+    uint8_t cls[32];  // 256-bit membership set for RE_CLASS
+};
+
+// Compiled pattern
+struct Regex {
+    RegexToken tok[REGEX_MAX_TOKENS];
+    int ntok;
+    bool anchor_start;  // '^'
+    bool anchor_end;    // '$'
+    bool literal;       // every token is a single RE_CHAR: plain substring search
+};
+
+// Called for each matching line (line excludes the '\n')
+typedef void (*GrepMatchFn)(const uint8_t* line, int len, int line_no, void* ctx);
+
+// First occurrence of c in s[0..len), or nullptr
+const uint8_t* find_byte(const uint8_t* s, int len, uint8_t c);
+
+bool regex_compile(Regex* re, const char* pattern);
+
+// Offset of the first match in text[0..len), or -1
+int regex_search(const Regex* re, const uint8_t* text, int len);
+
+// Report every line of data that matches; returns the number of lines
+int grep_buffer(const Regex* re, const uint8_t* data, int len, GrepMatchFn fn, void* ctx);
+
+#endif
@@ -3,7 +3,12 @@ December 2nd, 2025 - shell.cpp
 Description: Interactive command-line shell providing filesystem operations, process control, directory navigation, and user program invocation. */
 #include "shell.h"
 #include "fat.h"
+#include "timer.h"
 #include "scheduler.h"
+#include "commands.h"
+#include "search.h"
+#include "editor.h"
+#include "pipe.h"
 #include "embedded_user_programs.h"
 
 // Create a single global FAT instance
@@ -13,11 +18,47 @@ char cwd_path[128] = "/";
 
 volatile uint64_t* const UART0 = (uint64_t*)0x10000000;
 
+// Redirection state for the pipeline stage being run: output goes to a
+// pipe or a file instead of the UART, and input may come from a pipe.
+// Pipelines nest (source runs whole command lines inside a stage), so an
+// inner pipeline inherits the outer stage's input and output and puts them
+// back when it is done.
+static Pipe* out_pipe = nullptr;
+static Inode* out_file = nullptr;
+static Pipe* in_pipe = nullptr;
+static bool out_overflow = false;
+
+int shell_status = 0;
+
 // Minimal UART console
-extern "C" void putchar(char c) { *UART0 = (uint64_t)c; }
+extern "C" void putchar(char c) {
+    if (out_pipe) {
+        if (pipe_write(out_pipe, &c, 1) != 1) out_overflow = true;
+    } else if (out_file) {
+        if (out_file->size < MAX_FILE_SIZE) out_file->data[out_file->size++] = (uint8_t)c;
+        else out_overflow = true;
+    } else {
+        *UART0 = (uint64_t)c;
+    }
+}
+
+// Report a failed command on the console, bypassing any redirection
+void shell_fail(const char* msg) {
+    while (*msg) *UART0 = (uint64_t)*msg++;
+    shell_status = 1;
+}
+WaitQueue console_waiters = { nullptr, nullptr };
+
+bool console_has_input() {
+    volatile uint8_t* uart = (volatile uint8_t*)0x10000000;
+    return (uart[5] & 0x01) != 0;  // LSR data ready
+}
+
+// While waiting for a key, let ready processes run (a process blocked on
+// console input is woken first, so it gets the key)
 extern "C" char getchar() {
     volatile uint8_t* uart = (volatile uint8_t*)0x10000000;
-    while ((uart[5] & 0x01) == 0); // wait until data ready
+    while (!console_has_input()) scheduler_poll();
     return uart[0]; // read character
 }
 
@@ -156,24 +197,25 @@ void cmd_echo(const char* args) {
 }
 
 void cmd_clear(const char* args) {
+    (void)args;
     // ANSI escape code to clear screen and reset cursor
     print_str("\033[2J\033[H");
 }
 
 // --- Filesystem commands ---
 void cmd_mkdir(const char* args) {
-    if (!args || strlen(args) == 0) { print_str("Usage: mkdir <path>\n"); return; }
+    if (!args || strlen(args) == 0) { shell_fail("Usage: mkdir <path>\n"); return; }
 
     Directory* created = fat.mkdir_recursive(cwd, args);
     if (created) print_str("Directory created.\n");
-    else print_str("Failed to create directory.\n");
+    else shell_fail("Failed to create directory.\n");
 }
 
 void cmd_rmdir(const char* args) {
     if (fat.rmdir(cwd, args)) {
         print_str("Directory removed.\n");
     } else {
-        print_str("Failed to remove directory (not empty or does not exist).\n");
+        shell_fail("Failed to remove directory (not empty or does not exist).\n");
     }
 }
 
@@ -190,21 +232,39 @@ void cmd_touch(const char* args) {
     Directory* parent = fat.touch_recursive(cwd, args, name);
 
     if (!parent) {
-        print_str("Invalid path.\n");
+        shell_fail("Invalid path.\n");
         return;
     }
 
     if (fat.touch(parent, name))
         print_str("File created.\n");
     else
-        print_str("Failed to create file.\n");
+        shell_fail("Failed to create file.\n");
 }
 
 void cmd_rm(const char* args) {
+    // rm -r <dir> removes a directory tree
+    if (strncmp(args, "-r ", 3) == 0) {
+        const char* name = args + 3;
+        while (*name == ' ') name++;
+
+        Directory* target = fat.find_subdir(cwd, name);
+        if (!target) {
+            shell_fail("Directory not found.\n");
+        } else if (fat.contains(target, cwd)) {
+            shell_fail("Cannot remove the current directory.\n");
+        } else if (fat.rm_tree(cwd, name)) {
+            print_str("Directory tree removed.\n");
+        } else {
+            shell_fail("Failed to remove directory tree.\n");
+        }
+        return;
+    }
+
     if (fat.rm(cwd, args)) {
         print_str("File removed.\n");
     } else {
-        print_str("File not found.\n");
+        shell_fail("File not found.\n");
     }
 }
 
@@ -266,15 +326,182 @@ void cmd_mv(const char* args) {
     // Resolve destination directory
     Directory* dest_dir = traverse_path(dest, cwd);
     if (!dest_dir) {
-        print_str("Move failed: invalid destination\n");
+        shell_fail("Move failed: invalid destination\n");
         return;
     }
 
     if (fat.mv(cwd, src_name, dest_dir)) {
         print_str("Moved successfully.\n");
     } else {
-        print_str("Move failed.\n");
+        shell_fail("Move failed.\n");
+    }
+}
+
+void cmd_cp(const char* args) {
+    bool recursive = false;
+    if (strncmp(args, "-r ", 3) == 0) {
+        recursive = true;
+        args += 3;
+        while (*args == ' ') args++;
+    }
+
+    char src[64], dest[64];
+    int i = 0;
+
+    // Parse source
+    while (args[i] && args[i] != ' ' && i < 63) { src[i] = args[i]; i++; }
+    src[i] = '\0';
+
+    // Skip spaces
+    while (args[i] == ' ') i++;
+
+    // Parse destination
+    int j = 0;
+    while (args[i] && j < 63) dest[j++] = args[i++];
+    dest[j] = '\0';
+
+    if (src[0] == '\0' || dest[0] == '\0') {
+        shell_fail("Usage: cp [-r] <src> <dest>\n");
+        return;
+    }
+
+    // Copy into an existing directory under the source's name, otherwise
+    // treat the destination as "dir/.../newname"
+    char name[32];
+    Directory* dest_dir = traverse_path(dest, cwd);
+    if (dest_dir) {
+        const char* base = strrchr(src, '/');
+        strncpy(name, base ? base + 1 : src, 31);
+        name[31] = '\0';
+    } else {
+        dest_dir = fat.touch_recursive(cwd, dest, name);
+    }
+    if (!dest_dir) {
+        shell_fail("Copy failed: invalid destination\n");
+        return;
+    }
+
+    bool ok;
+    if (recursive) {
+        Directory* src_dir = traverse_path(src, cwd);
+        ok = src_dir && fat.cp_tree(src_dir, dest_dir, name);
+    } else {
+        ok = fat.cp(fat.resolve_file(cwd, src), dest_dir, name) != nullptr;
+    }
+
+    if (ok) print_str("Copied successfully.\n");
+    else shell_fail("Copy failed.\n");
+}
+
+void cmd_du(const char* args) {
+    Directory* dir = (!args || args[0] == '\0') ? cwd : traverse_path(args, cwd);
+    if (!dir) {
+        shell_fail("Error: invalid directory\n");
+        return;
+    }
+
+    int files = 0;
+    uint32_t bytes = fat.du(dir, &files);
+
+    char buf[16];
+    itoa(bytes, buf, 10);
+    print_str(buf); print_str(" bytes in ");
+    itoa(files, buf, 10);
+    print_str(buf); print_str(" files\n");
+}
+
+void cmd_find(const char* args) {
+    if (!args || strlen(args) == 0) {
+        shell_fail("Usage: find <pattern>\n");
+        return;
+    }
+
+    if (fat.find(cwd, args, "./") == 0) shell_fail("No matches.\n");
+}
+
+// --- Content search ---
+static Regex grep_re;  // compiled once per command; too large for the shell stack
+
+struct GrepCtx { const char* path; int matches; };
+
+static void grep_print_line(const uint8_t* line, int len, int line_no, void* ctx) {
+    GrepCtx* g = (GrepCtx*)ctx;
+    char buf[16];
+
+    if (g->path) {
+        print_str(g->path);
+        putchar(':');
     }
+    itoa(line_no, buf, 10);
+    print_str(buf);
+    print_str(": ");
+    for (int i = 0; i < len; i++) putchar(line[i]);
+    putchar('\n');
+}
+
+static bool grep_visit(WalkEvent ev, Directory* dir, File* f, const char* path, void* ctx) {
+    (void)dir;
+    if (ev != WALK_FILE || !(f->inode->mode & MODE_READ)) return true;
+
+    GrepCtx* g = (GrepCtx*)ctx;
+    g->path = path;
+    g->matches += grep_buffer(&grep_re, f->inode->data, f->inode->size, grep_print_line, g);
+    return true;
+}
+
+void cmd_grep(const char* args) {
+    bool recursive = false;
+    if (strncmp(args, "-r ", 3) == 0) {
+        recursive = true;
+        args += 3;
+        while (*args == ' ') args++;
+    }
+
+    // Pattern is one word, or a "quoted string" that may contain spaces
+    char pattern[64];
+    int i = 0;
+    if (*args == '"') {
+        args++;
+        while (*args && *args != '"' && i < 63) pattern[i++] = *args++;
+        if (*args == '"') args++;
+    } else {
+        while (*args && *args != ' ' && i < 63) pattern[i++] = *args++;
+    }
+    pattern[i] = '\0';
+    while (*args == ' ') args++;
+
+    if (pattern[0] == '\0' || (!recursive && *args == '\0' && !in_pipe)) {
+        shell_fail("Usage: grep [-r] <pattern> <path>\n");
+        return;
+    }
+    if (!regex_compile(&grep_re, pattern)) {
+        shell_fail("Invalid pattern\n");
+        return;
+    }
+
+    GrepCtx g = { nullptr, 0 };
+    if (recursive) {
+        Directory* dir = (*args == '\0') ? cwd : traverse_path(args, cwd);
+        if (!dir) {
+            shell_fail("Error: invalid directory\n");
+            return;
+        }
+        fat.walk(dir, grep_visit, &g);
+    } else if (*args == '\0') {
+        // Search piped input
+        static uint8_t input[PIPE_BUF_SIZE];
+        int n = pipe_read(in_pipe, input, sizeof(input));
+        g.matches = grep_buffer(&grep_re, input, n > 0 ? n : 0, grep_print_line, &g);
+    } else {
+        File* f = fat.resolve_file(cwd, args);
+        if (!f || !(f->inode->mode & MODE_READ)) {
+            shell_fail("File not found\n");
+            return;
+        }
+        g.matches = grep_buffer(&grep_re, f->inode->data, f->inode->size, grep_print_line, &g);
+    }
+
+    if (g.matches == 0) shell_fail("No matches.\n");
 }
 
 void cmd_cd(const char* path) {
@@ -298,7 +525,7 @@ void cmd_cd(const char* path) {
         } else if (strlen(component) > 0) {
             Directory* next = fat.find_subdir(dir, component);
             if (!next) {
-                print_str("Error: directory not found\n");
+                shell_fail("Error: directory not found\n");
                 return;
             }
             dir = next;
@@ -308,49 +535,6 @@ void cmd_cd(const char* path) {
     cwd = dir;
 }
 
-void cmd_ps(const char* args) {
-    Process* table = scheduler_get_process_table();
-    int max = scheduler_get_max_procs();
-
-    print_str("PID\tName\t\tState\n");
-    print_str("-------------------------------\n");
-
-    for (int i = 0; i < max; ++i) {
-        Process* p = &table[i];
-        if (p->state == PROC_FREE) continue;
-
-        // PID
-        char buf[8];
-        itoa(p->pid, buf, 10);
-        print_str(buf);
-        print_str("\t");
-
-        // Name
-        if (p->name) {
-            print_str(p->name);
-
-            int len = strlen(p->name);
-
-            if (len < 8)
-                print_str("\t\t");   // short name → more spacing
-            else
-                print_str("\t");     // long name → single tab
-        } else {
-            print_str("(no name)\t");
-        }
-
-        // State
-        switch (p->state) {
-            case PROC_READY:   print_str("READY"); break;
-            case PROC_RUNNING: print_str("RUNNING"); break;
-            case PROC_SLEEP:   print_str("SLEEP"); break;
-            case PROC_ZOMBIE:  print_str("ZOMBIE"); break;
-            default:           print_str("UNKNOWN"); break;
-        }
-        print_str("\n");
-    }
-}
-
 void update_cwd_path() {
     Directory* temp = cwd;
     char rev_path[128] = "";
@@ -384,98 +568,150 @@ void update_cwd_path() {
 }
 
 void cmd_pwd(const char* args) {
+    (void)args;
     update_cwd_path();
     print_str(cwd_path);
     print_str("\n");
 }
 
 void cmd_cat(const char* args) {
+    // With no file, copy piped input through
+    if ((!args || strlen(args) == 0) && in_pipe) {
+        char chunk[128];
+        int n;
+        while ((n = pipe_read(in_pipe, chunk, sizeof(chunk))) > 0) {
+            for (int i = 0; i < n; i++) putchar(chunk[i]);
+        }
+        return;
+    }
+
     if (!args || strlen(args) == 0) {
-        print_str("Usage: cat <filename>\n");
+        shell_fail("Usage: cat <filename>\n");
         return;
     }
 
-    File* f = fat.find_file(cwd, args);
-    if (!f) {
-        print_str("File not found\n");
+    OpenFile* of = fat.open(fat.resolve_file(cwd, args));
+    if (!of) {
+        shell_fail("File not found\n");
         return;
     }
 
-    for (int i = 0; i <= f->size; i++) {
-        putchar(f->data[i]);
+    // Stream through an open handle so sequential readahead kicks in
+    char chunk[128];
+    int n;
+    while ((n = fat.read(of, chunk, sizeof(chunk))) > 0) {
+        for (int i = 0; i < n; i++) putchar(chunk[i]);
     }
+    fat.close(of);
     putchar('\n');
 }
 
 void cmd_edit(const char* args, bool append_mode = false) {
     if (!args || strlen(args) == 0) {
-        print_str("Usage: edit|append <filename>\n");
+        shell_fail("Usage: edit|append <filename>\n");
         return;
     }
 
     File* f = fat.find_file(cwd, args);
     if (!f) {
-        print_str("File not found\n");
+        shell_fail("File not found\n");
         return;
     }
 
-    int pos = append_mode ? f->size : 0;
-    if (!append_mode) f->size = 0; // clear for normal edit
+    if (!(f->inode->mode & MODE_WRITE)) {
+        shell_fail("Permission denied\n");
+        return;
+    }
 
-    print_str(append_mode ? "Append mode (Ctrl+D to finish):\n" 
-                          : "Enter new content (end with Ctrl+D):\n");
+    editor_run(f, append_mode);
+    print_str("File closed.\n");
+}
 
-    while (pos < MAX_FILE_SIZE) {
-        char c = getchar();
+// Print a tick count as milliseconds since boot
+static void print_ms(uint64_t ticks) {
+    char buf[16];
+    itoa((uint32_t)(ticks / TIMER_TICKS_PER_MS), buf, 10);
+    print_str(buf);
+    print_str(" ms");
+}
 
-        if (c == 4) break; // Ctrl+D ends input
+void cmd_stat(const char* args) {
+    if (!args || strlen(args) == 0) {
+        shell_fail("Usage: stat <path>\n");
+        return;
+    }
 
-        // Handle newlines correctly
-        if (c == '\r' || c == '\n') {
-            putchar('\n');    // move cursor down
-            f->data[pos++] = '\n'; // store LF only
-        } else {
-            putchar(c);
-            f->data[pos++] = c;
-        }
+    File* f = fat.resolve_file(cwd, args);
+    if (!f) {
+        shell_fail("File not found\n");
+        return;
     }
 
-    f->size = pos;
-    f->used = true;
-    print_str("\nFile updated.\n");
+    Inode* ino = f->inode;
+    char buf[16];
+
+    print_str("Name:   "); print_str(f->name); print_str("\n");
+    itoa(ino->size, buf, 10);
+    print_str("Size:   "); print_str(buf); print_str(" bytes\n");
+    itoa(ino->nlink, buf, 10);
+    print_str("Links:  "); print_str(buf); print_str("\n");
+    print_str("Mode:   ");
+    putchar((ino->mode & MODE_READ) ? 'r' : '-');
+    putchar((ino->mode & MODE_WRITE) ? 'w' : '-');
+    putchar((ino->mode & MODE_EXEC) ? 'x' : '-');
+    print_str("\nModify: "); print_ms(ino->mtime);
+    print_str("\nChange: "); print_ms(ino->ctime);
+    print_str("\n");
 }
 
-void cmd_df(const char* args) {
-    char buf[32];
+void cmd_ln(const char* args) {
+    char src[32], dest[64];
+    int i = 0;
 
-    int used_dirs = fat.count_used_dirs();
-    int free_dirs = fat.count_free_dirs();
-    int used_files = fat.count_used_files();
-    int free_files = fat.count_free_files();
-    uint32_t total_bytes = fat.total_file_bytes();
+    // Parse source
+    while (args[i] && args[i] != ' ' && i < 31) { src[i] = args[i]; i++; }
+    src[i] = '\0';
 
-    print_str("Resource\tUsed\tFree\tMax\n");
-    print_str("-------------------------------------\n");
+    // Skip spaces
+    while (args[i] == ' ') i++;
 
-    itoa(used_dirs, buf, 10);
-    print_str("Directories\t"); print_str(buf); print_str("\t");
-    itoa(free_dirs, buf, 10);
-    print_str(buf); print_str("\t");
-    itoa(MAX_DIRS, buf, 10);
-    print_str(buf); print_str("\n");
+    // Parse destination
+    int j = 0;
+    while (args[i] && j < 63) dest[j++] = args[i++];
+    dest[j] = '\0';
 
-    itoa(used_files, buf, 10);
-    print_str("Files\t\t"); print_str(buf); print_str("\t");
-    itoa(free_files, buf, 10);
-    print_str(buf); print_str("\t");
-    itoa(MAX_FILES, buf, 10);
-    print_str(buf); print_str("\n\n");
+    if (src[0] == '\0' || dest[0] == '\0') {
+        shell_fail("Usage: ln <src> <dest>\n");
+        return;
+    }
 
-    itoa(total_bytes / 1024, buf, 10);
-    print_str("Used Space: "); print_str(buf); print_str(" KB\n");
+    // Destination may be "name" or "dir/.../name"
+    char name[32];
+    Directory* dest_dir = fat.touch_recursive(cwd, dest, name);
+    if (dest_dir && fat.link(cwd, resolve_path(src), dest_dir, name)) {
+        print_str("Link created.\n");
+    } else {
+        shell_fail("Link failed.\n");
+    }
+}
 
-    itoa((MAX_FILES * MAX_FILE_SIZE) / 1024, buf, 10);
-    print_str("Total Space: "); print_str(buf); print_str(" MB\n");
+void cmd_chmod(const char* args) {
+    // Mode is one octal digit (r=4, w=2, x=1) followed by a path
+    if (!args || args[0] < '0' || args[0] > '7' || args[1] != ' ') {
+        shell_fail("Usage: chmod <0-7> <path>\n");
+        return;
+    }
+
+    const char* path = args + 1;
+    while (*path == ' ') path++;
+
+    char name[32];
+    Directory* parent = fat.resolve_parent(cwd, path, name);
+    if (parent && fat.chmod(parent, name, (uint16_t)(args[0] - '0'))) {
+        print_str("Mode changed.\n");
+    } else {
+        shell_fail("File not found\n");
+    }
 }
 
 void cmd_edit_wrapper(const char* args) { cmd_edit(args, false); }
@@ -484,20 +720,20 @@ void cmd_append_wrapper(const char* args) { cmd_edit(args, true); }
 // Run program with visual display
 void cmd_run(const char* args) {
     if (!args || strlen(args) == 0) {
-        print_str("Usage: run <program.S>\n");
+        shell_fail("Usage: run <program.S>\n");
         return;
     }
 
     // Must be in /user_programs
     if (!cwd || strcmp(cwd->name, "user_programs") != 0) {
-        print_str("Error: No user programs were found\n");
+        shell_fail("Error: No user programs were found\n");
         return;
     }
 
     // Require .S extension
     const char* ext = strrchr(args, '.');
     if (!ext || strcmp(ext, ".S") != 0) {
-        print_str("Error: You must specify an assembly (.S) file\n");
+        shell_fail("Error: You must specify an assembly (.S) file\n");
         return;
     }
 
@@ -505,7 +741,7 @@ void cmd_run(const char* args) {
     char base[64];
     int base_len = (int)(ext - args);  // number of chars before ".S"
     if (base_len <= 0 || base_len >= (int)sizeof(base)) {
-        print_str("Error: Invalid program name\n");
+        shell_fail("Error: Invalid program name\n");
         return;
     }
 
@@ -514,6 +750,17 @@ void cmd_run(const char* args) {
     }
     base[base_len] = '\0';
 
+    // The source file must exist and carry the execute bit
+    File* src = fat.find_file(cwd, args);
+    if (!src) {
+        shell_fail("Error: Program not found\n");
+        return;
+    }
+    if (!(src->inode->mode & MODE_EXEC)) {
+        shell_fail("Error: Permission denied\n");
+        return;
+    }
+
     // Search for the embedded program by base name (e.g. "counter")
     for (unsigned int i = 0; i < embedded_file_count; i++) {
         if (strcmp(base, embedded_files[i].name) == 0) {
@@ -527,70 +774,86 @@ void cmd_run(const char* args) {
             );
 
             if (pid <= 0) {
-                print_str("Error: Failed to create process\n");
-            } else {
-                scheduler_run_pid(pid);
+                shell_fail("Error: Failed to create process\n");
+                return;
             }
+
+            // Inside a pipeline the program streams through fds 0 and 1
+            Process* proc = scheduler_get_proc_by_pid(pid);
+            if (in_pipe) {
+                pipe_retain(in_pipe, false);
+                proc->fds[0] = { FD_PIPE_READ, nullptr, in_pipe };
+            }
+            if (out_pipe) {
+                pipe_retain(out_pipe, true);
+                proc->fds[1] = { FD_PIPE_WRITE, nullptr, out_pipe };
+            }
+            scheduler_run_pid(pid);
             return;
         }
     }
 
-    print_str("Error: Program has no binary or doesn't exist\n");
+    shell_fail("Error: Program has no binary or doesn't exist\n");
 }
 
 void cmd_exit(const char* args) {
+    (void)args;
     print_str("To perform a clean exit, use 'Ctrl+A X'.\n");
     print_str("Otherwise, use 'Ctrl+A C' to enter the QEMU monitor, then type 'quit'.\n");
 }
 
+// --- Command history ---
+#define SHELL_LINE_MAX 256
+#define SHELL_HISTORY 16
+
+// Ring of recent lines; hist_next is where the next entry goes
+static char history[SHELL_HISTORY][SHELL_LINE_MAX];
+static int hist_count = 0;
+static int hist_next = 0;
+
+// Entry n steps back (1 = most recent)
+static const char* history_get(int n) {
+    return history[(hist_next - n + SHELL_HISTORY) % SHELL_HISTORY];
+}
+
+static void history_add(const char* line) {
+    if (line[0] == '\0') return;
+    if (hist_count > 0 && strcmp(history_get(1), line) == 0) return;  // skip repeats
+
+    strcpy(history[hist_next], line);
+    hist_next = (hist_next + 1) % SHELL_HISTORY;
+    if (hist_count < SHELL_HISTORY) hist_count++;
+}
+
+void cmd_history(const char* args) {
+    (void)args;
+    char buf[8];
+    for (int n = hist_count; n >= 1; n--) {
+        itoa(hist_count - n + 1, buf, 10);
+        print_str("  ");
+        print_str(buf);
+        print_str("  ");
+        print_str(history_get(n));
+        print_str("\n");
+    }
+}
+
 void cmd_help(const char* args) {
+    (void)args;
     print_str("Available Commands:\n");
-    print_str("  • 'help'\t\tShow this help message.\n");
-    print_str("  • 'echo <args>'\tEcho arguments.\n");
-    print_str("  • 'clear'\t\tClear the screen.\n");
-    print_str("  • 'mkdir <name>'\tCreate a new directory.\n");
-    print_str("  • 'rmdir <name>'\tRemove a directory.\n");
-    print_str("  • 'ls'\t\tList files and directories.\n");
-    print_str("  • 'touch <name>'\tCreate a new file.\n");
-    print_str("  • 'rm <name>'\t\tDelete a file.\n");
-    print_str("  • 'run <name>'\tRun a user program.\n");
-    print_str("  • 'mv <src> <dest>'\tMove a file to another directory.\n");
-    print_str("  • 'cd <dir>'\t\tChange current directory.\n");
-    print_str("  • 'df'\t\tDisplay current storage and resources.\n");
-    print_str("  • 'pwd'\t\tPrint current working directory.\n");
-    print_str("  • 'ps'\t\tDisplay all currently running processes.\n");
-    print_str("  • 'cat <name>'\tDump a file's contents to the console.\n");
-    print_str("  • 'edit <name>'\tOverwrite a file's contents.\n");
-    print_str("  • 'append <name>'\tAppend to a file's contents.\n");
-    print_str("  • 'exit'\t\tAdvises the user on how to exit the OS.\n");
-}
-
-struct Command {
-    const char* name;
-    void (*func)(const char* args);
-};
+    for (int j = 0; commands[j].name != nullptr; j++) {
+        print_str("  • ");
+        print_str(commands[j].help);
+        print_str("\n");
+    }
+}
 
-Command commands[] = {
-    {"help", cmd_help},
-    {"echo", cmd_echo},
-    {"clear", cmd_clear},
-    {"mkdir", cmd_mkdir},
-    {"rmdir", cmd_rmdir},
-    {"ls", cmd_ls},
-    {"touch", cmd_touch},
-    {"rm", cmd_rm},
-    {"mv", cmd_mv},
-    {"cd", cmd_cd},
-    {"df", cmd_df},
-    {"pwd", cmd_pwd},
-    {"ps", cmd_ps},
-    {"cat", cmd_cat},
-    {"edit", cmd_edit_wrapper},
-    {"run", cmd_run},
-    {"append", cmd_append_wrapper},
-    {"exit", cmd_exit},
-    {nullptr, nullptr}  // sentinel
+#define COMMAND_ENTRY(name, func, help) {name, func, help},
+const Command commands[] = {
+    ALL_COMMANDS(COMMAND_ENTRY)
+    {nullptr, nullptr, nullptr}  // sentinel
 };
+#undef COMMAND_ENTRY
 
 extern "C" void handle_command(const char* line) {
     char cmd[32];
@@ -608,77 +871,490 @@ extern "C" void handle_command(const char* line) {
     args = line + i;
     while (*args == ' ') args++;
 
-    // Lookup command
-    for (int j = 0; commands[j].name != nullptr; j++) {
-        if (strcmp(cmd, commands[j].name) == 0) {
-            commands[j].func(args);
+    // Lookup command (compile-time perfect hash)
+    const Command* command = find_command(cmd);
+    shell_status = 0;
+    if (command) {
+        command->func(args);
+        return;
+    }
+
+    shell_fail("Unknown command: ");
+    shell_fail(cmd);
+    shell_fail("\n");
+    shell_status = 127;
+}
+
+// ---------------------------------------------------------------------
+// Command lines
+// A line is a sequence of pipelines joined by ';' (always run the next)
+// or '&&' (run the next only on success). A pipeline is up to
+// MAX_PIPELINE commands joined by '|', each stage's output buffered in a
+// kernel pipe for the next, and the last may end in '> file' or
+// '>> file'. Separators inside "quotes" are ignored.
+// ---------------------------------------------------------------------
+#define MAX_PIPELINE 4
+#define MAX_SOURCE_DEPTH 4
+
+// Per-nesting-level buffers so 'source' does not grow the shell stack
+static int source_depth = 0;
+static char segment_buf[MAX_SOURCE_DEPTH + 1][SHELL_LINE_MAX];
+static char source_line[MAX_SOURCE_DEPTH][SHELL_LINE_MAX];
+
+static char* trim(char* s) {
+    while (*s == ' ') s++;
+    int n = strlen(s);
+    while (n > 0 && s[n - 1] == ' ') s[--n] = '\0';
+    return s;
+}
+
+// Index of c outside "quotes", or -1
+static int find_unquoted(const char* s, char c) {
+    bool quoted = false;
+    for (int i = 0; s[i]; i++) {
+        if (s[i] == '"') quoted = !quoted;
+        else if (!quoted && s[i] == c) return i;
+    }
+    return -1;
+}
+
+// Open (creating if needed) the target of '>' or '>>'
+static Inode* open_redirect(const char* path, bool append) {
+    File* f = fat.resolve_file(cwd, path);
+    if (!f) {
+        Directory* start = cwd;
+        if (path[0] == '/') {
+            start = fat.get_root();
+            while (*path == '/') path++;
+        }
+        char name[32];
+        Directory* parent = fat.touch_recursive(start, path, name);
+        if (parent) f = fat.touch(parent, name);
+    }
+    if (!f || !(f->inode->mode & MODE_WRITE)) return nullptr;
+
+    if (!append) f->inode->size = 0;
+    return f->inode;
+}
+
+static void run_pipeline(char* seg) {
+    char* stages[MAX_PIPELINE];
+    int n = 0;
+
+    stages[n++] = seg;
+    for (int k; (k = find_unquoted(stages[n - 1], '|')) >= 0; ) {
+        if (n == MAX_PIPELINE) {
+            shell_fail("Pipeline too long.\n");
             return;
         }
+        stages[n - 1][k] = '\0';
+        stages[n] = stages[n - 1] + k + 1;
+        n++;
     }
 
-    print_str("Unknown command: ");
-    print_str(cmd);
-    print_str("\n");
+    // Output redirection applies to the last stage
+    Inode* target = nullptr;
+    char* last = stages[n - 1];
+    int r = find_unquoted(last, '>');
+    if (r >= 0) {
+        bool append = last[r + 1] == '>';
+        char* path = trim(last + r + (append ? 2 : 1));
+        last[r] = '\0';
+
+        target = open_redirect(path, append);
+        if (!target) {
+            shell_fail("Cannot open redirect target.\n");
+            return;
+        }
+    }
+
+    Pipe* outer_in = in_pipe;
+    Pipe* outer_out = out_pipe;
+    Inode* outer_file = out_file;
+    bool outer_overflow = out_overflow;
+
+    Pipe* prev = nullptr;
+    for (int i = 0; i < n; i++) {
+        Pipe* next = nullptr;
+        if (i < n - 1) {
+            next = pipe_create();
+            if (!next) {
+                shell_fail("No free pipes.\n");
+                break;
+            }
+        }
+
+        // The first stage reads the outer input, and a last stage without
+        // its own '>' writes to the outer output
+        bool inherits_out = (i == n - 1) && !target;
+        in_pipe = (i == 0) ? outer_in : prev;
+        out_pipe = inherits_out ? outer_out : next;
+        out_file = inherits_out ? outer_file : (i == n - 1 ? target : nullptr);
+        out_overflow = false;
+
+        handle_command(trim(stages[i]));
+
+        bool overflow = out_overflow;
+        in_pipe = outer_in;
+        out_pipe = outer_out;
+        out_file = outer_file;
+        out_overflow = outer_overflow || (overflow && inherits_out);
+        outer_overflow = out_overflow;
+        if (overflow && !inherits_out) print_str("(shell) Output truncated.\n");
+
+        if (prev) pipe_close_read(prev);
+        if (next) pipe_close_write(next);
+        prev = next;
+    }
+    if (prev) pipe_close_read(prev);
+
+    if (target) fat.mark_modified(target);
 }
 
-extern "C" void shell_main() {
-    char line[128];
+static void run_line(const char* line) {
+    char* seg = segment_buf[source_depth];
+    bool skip = false;
+    int i = 0;
+
+    while (line[i]) {
+        // Copy up to the next unquoted ';' or '&&'
+        int n = 0;
+        bool quoted = false;
+        bool and_next = false;
+        while (line[i]) {
+            char c = line[i];
+            if (c == '"') quoted = !quoted;
+            if (!quoted && c == ';') { i++; break; }
+            if (!quoted && c == '&' && line[i + 1] == '&') { i += 2; and_next = true; break; }
+            if (n < SHELL_LINE_MAX - 1) seg[n++] = c;
+            i++;
+        }
+        seg[n] = '\0';
+
+        char* cmd = trim(seg);
+        if (!skip && cmd[0]) run_pipeline(cmd);
+
+        // After a failure, '&&' skips the rest of the chain up to a ';'
+        skip = and_next && (skip || shell_status != 0);
+    }
+}
+
+// Run each line of a file; '#' starts a comment line
+void cmd_source(const char* args) {
+    File* f = fat.resolve_file(cwd, args);
+    if (!f || !(f->inode->mode & MODE_READ)) {
+        shell_fail("File not found\n");
+        return;
+    }
+    if (source_depth >= MAX_SOURCE_DEPTH) {
+        shell_fail("source: nested too deeply\n");
+        return;
+    }
+
+    Inode* ino = f->inode;
+    char* line = source_line[source_depth];
+    source_depth++;
+
     int pos = 0;
-    const int min_pos = 0; // Editable area starts after prompt
+    while (pos < ino->size) {
+        int n = 0;
+        while (pos < ino->size && ino->data[pos] != '\n') {
+            if (n < SHELL_LINE_MAX - 1 && ino->data[pos] != '\r') line[n++] = (char)ino->data[pos];
+            pos++;
+        }
+        pos++;  // skip '\n'
+        line[n] = '\0';
+
+        char* cmd = trim(line);
+        if (cmd[0] && cmd[0] != '#') run_line(cmd);
+    }
+
+    source_depth--;
+}
+
+// ---------------------------------------------------------------------
+// Line editing
+// The cursor can sit anywhere in the line; edits redraw only the text from
+// the cursor onward and then walk the terminal cursor back into place.
+// ---------------------------------------------------------------------
+#define KEY_CTRL_A 1
+#define KEY_CTRL_E 5
+#define KEY_CTRL_W 23
+
+struct LineEditor {
+    char* line;
+    int len;
+    int pos;
+    int browse;                     // history steps back, 0 = the draft
+    char draft[SHELL_LINE_MAX];     // line being typed before browsing
+};
+
+static void print_prompt() {
     char name_buf[64];
-    cwd = fat.get_root();
 
-    while (1) {
-        // Print current directory in brackets
-        print_str("(shell) user [");
-        if (strcmp(cwd->name, "") != 0) {
-            strcpy(name_buf, "../");
-            strcat(name_buf, cwd->name);
-            print_str(name_buf);
-        } else {
-            print_str("/");
-        }
-        print_str("] > ");      // followed by prompt
-
-        pos = 0;
-
-        // Read a line
-        while (1) {
-            char c = getchar();
-
-            // Handle escape sequences (arrow keys)
-            if (c == 0x1B) { // ESC
-                char next1 = getchar();
-                char next2 = getchar();
-                if (next1 == '[') {
-                    // Ignore arrows
-                    switch (next2) {
-                        case 'D': /* left arrow */ break;
-                        case 'A': /* up arrow */ break;
-                        case 'C': /* right arrow */ break;
-                        case 'B': /* down arrow */ break;
-                    }
-                }
-                continue;
-            }
+    // Print current directory in brackets
+    print_str("(shell) user [");
+    if (strcmp(cwd->name, "") != 0) {
+        strcpy(name_buf, "../");
+        strcat(name_buf, cwd->name);
+        print_str(name_buf);
+    } else {
+        print_str("/");
+    }
+    print_str("] > ");      // followed by prompt
+}
 
-            if (c == '\r' || c == '\n') { // Enter key
-                putchar('\n');
-                line[pos] = '\0';
-                break;
+static void cursor_left(int n) {
+    if (n <= 0) return;
+    char buf[8];
+    itoa(n, buf, 10);
+    print_str("\033[");
+    print_str(buf);
+    putchar('D');
+}
+
+static void cursor_right(int n) {
+    if (n <= 0) return;
+    char buf[8];
+    itoa(n, buf, 10);
+    print_str("\033[");
+    print_str(buf);
+    putchar('C');
+}
+
+// Reprint from the cursor to the end, erase leftovers, restore the cursor
+static void redraw_tail(LineEditor* le) {
+    for (int i = le->pos; i < le->len; i++) putchar(le->line[i]);
+    print_str("\033[K");
+    cursor_left(le->len - le->pos);
+}
+
+static void insert_text(LineEditor* le, const char* text, int n) {
+    if (le->len + n > SHELL_LINE_MAX - 1) n = SHELL_LINE_MAX - 1 - le->len;
+    if (n <= 0) return;
+
+    for (int i = le->len - 1; i >= le->pos; i--) le->line[i + n] = le->line[i];
+    for (int i = 0; i < n; i++) le->line[le->pos + i] = text[i];
+    le->len += n;
+
+    for (int i = 0; i < n; i++) putchar(text[i]);
+    le->pos += n;
+    redraw_tail(le);
+}
+
+// Remove n characters before the cursor
+static void erase_before(LineEditor* le, int n) {
+    if (n > le->pos) n = le->pos;
+    if (n <= 0) return;
+
+    for (int i = le->pos; i < le->len; i++) le->line[i - n] = le->line[i];
+    le->len -= n;
+    le->pos -= n;
+
+    cursor_left(n);
+    redraw_tail(le);
+}
+
+static void replace_line(LineEditor* le, const char* text) {
+    cursor_left(le->pos);
+    le->pos = le->len = 0;
+    insert_text(le, text, strlen(text));
+}
+
+static void history_step(LineEditor* le, int dir) {
+    int target = le->browse + dir;
+    if (target < 0 || target > hist_count) return;
+
+    if (le->browse == 0) {
+        le->line[le->len] = '\0';
+        strcpy(le->draft, le->line);
+    }
+    le->browse = target;
+    replace_line(le, target == 0 ? le->draft : history_get(target));
+}
+
+// --- Tab completion ---
+struct Completion {
+    const char* first;  // first candidate found
+    int count;
+    int common;         // length shared by every candidate
+    bool first_is_dir;
+};
+
+static void completion_add(Completion* c, const char* name, const char* prefix, int plen, bool is_dir) {
+    if (strncmp(name, prefix, plen) != 0) return;
+
+    if (c->count == 0) {
+        c->first = name;
+        c->common = strlen(name);
+        c->first_is_dir = is_dir;
+    } else {
+        int k = plen;
+        while (k < c->common && name[k] == c->first[k]) k++;
+        c->common = k;
+    }
+    c->count++;
+}
+
+static void completion_list(const char* prefix, int plen, Directory* dir) {
+    putchar('\n');
+    if (!dir) {
+        for (int j = 0; commands[j].name != nullptr; j++) {
+            if (strncmp(commands[j].name, prefix, plen) == 0) {
+                print_str(commands[j].name);
+                print_str("  ");
             }
+        }
+    } else {
+        for (int i = 0; i < dir->subdir_count; i++) {
+            if (strncmp(dir->subdirs[i]->name, prefix, plen) != 0) continue;
+            print_str(dir->subdirs[i]->name);
+            print_str("/  ");
+        }
+        for (int i = 0; i < dir->file_count; i++) {
+            if (strncmp(dir->files[i]->name, prefix, plen) != 0) continue;
+            print_str(dir->files[i]->name);
+            print_str("  ");
+        }
+    }
+    putchar('\n');
+}
 
-            if (c == '\b' || c == 127) { // Backspace
-                if (pos > min_pos) {
-                    pos--;
-                    print_str("\b \b");
-                }
-            } else if (pos < 127) {
-                line[pos++] = c;
-                putchar(c);
+// Complete the word before the cursor: a command name for the first word,
+// otherwise a path resolved through the filesystem
+static void complete(LineEditor* le) {
+    int ws = le->pos;
+    while (ws > 0 && le->line[ws - 1] != ' ') ws--;
+
+    char word[SHELL_LINE_MAX];
+    int wlen = le->pos - ws;
+    for (int i = 0; i < wlen; i++) word[i] = le->line[ws + i];
+    word[wlen] = '\0';
+
+    Completion c = { nullptr, 0, 0, false };
+    Directory* dir = nullptr;
+    const char* prefix = word;
+
+    bool first_word = true;
+    for (int i = 0; i < ws; i++) if (le->line[i] != ' ') first_word = false;
+
+    if (first_word) {
+        for (int j = 0; commands[j].name != nullptr; j++) {
+            completion_add(&c, commands[j].name, word, wlen, false);
+        }
+    } else {
+        // Split "dir/part" into the directory to search and the name prefix
+        const char* slash = strrchr(word, '/');
+        dir = cwd;
+        if (slash) {
+            prefix = slash + 1;
+            if (slash == word) {
+                dir = fat.get_root();
+            } else {
+                word[slash - word] = '\0';
+                dir = traverse_path(word, cwd);
             }
+            if (!dir) return;
+        }
+
+        int plen = strlen(prefix);
+        for (int i = 0; i < dir->subdir_count; i++) completion_add(&c, dir->subdirs[i]->name, prefix, plen, true);
+        for (int i = 0; i < dir->file_count; i++) completion_add(&c, dir->files[i]->name, prefix, plen, false);
+    }
+
+    int plen = strlen(prefix);
+    if (c.count == 0) return;
+
+    if (c.common > plen) {
+        insert_text(le, c.first + plen, c.common - plen);
+    }
+    if (c.count == 1) {
+        insert_text(le, c.first_is_dir ? "/" : " ", 1);
+    } else if (c.common == plen) {
+        // Nothing left in common: show the candidates and redraw the line
+        completion_list(prefix, plen, first_word ? nullptr : dir);
+        print_prompt();
+        for (int i = 0; i < le->len; i++) putchar(le->line[i]);
+        cursor_left(le->len - le->pos);
+    }
+}
+
+// Handle "ESC [ x" and "ESC [ n ~" sequences
+static void handle_escape(LineEditor* le) {
+    if (getchar() != '[') return;
+
+    char c = getchar();
+    if (c >= '0' && c <= '9') {
+        if (getchar() == '~' && c == '3' && le->pos < le->len) {  // Delete
+            le->pos++;
+            cursor_right(1);
+            erase_before(le, 1);
         }
+        return;
+    }
 
-        handle_command(line);
+    switch (c) {
+        case 'A': history_step(le, 1); break;    // up arrow
+        case 'B': history_step(le, -1); break;   // down arrow
+        case 'C':                                // right arrow
+            if (le->pos < le->len) { le->pos++; cursor_right(1); }
+            break;
+        case 'D':                                // left arrow
+            if (le->pos > 0) { le->pos--; cursor_left(1); }
+            break;
+        case 'H': cursor_left(le->pos); le->pos = 0; break;                          // Home
+        case 'F': cursor_right(le->len - le->pos); le->pos = le->len; break;         // End
+    }
+}
+
+static void read_line(char* line) {
+    static LineEditor le;
+    le.line = line;
+    le.len = 0;
+    le.pos = 0;
+    le.browse = 0;
+
+    while (1) {
+        char c = getchar();
+
+        if (c == '\r' || c == '\n') { // Enter key
+            putchar('\n');
+            line[le.len] = '\0';
+            return;
+        }
+
+        if (c == 0x1B) {
+            handle_escape(&le);
+        } else if (c == '\t') {
+            complete(&le);
+        } else if (c == KEY_CTRL_A) {
+            cursor_left(le.pos);
+            le.pos = 0;
+        } else if (c == KEY_CTRL_E) {
+            cursor_right(le.len - le.pos);
+            le.pos = le.len;
+        } else if (c == KEY_CTRL_W) {
+            // Delete the word before the cursor, and the spaces before it
+            int p = le.pos;
+            while (p > 0 && line[p - 1] == ' ') p--;
+            while (p > 0 && line[p - 1] != ' ') p--;
+            erase_before(&le, le.pos - p);
+        } else if (c == '\b' || c == 127) { // Backspace
+            erase_before(&le, 1);
+        } else if (c >= 32 && c < 127) {
+            insert_text(&le, &c, 1);
+        }
+    }
+}
+
+extern "C" void shell_main() {
+    static char line[SHELL_LINE_MAX];
+    cwd = fat.get_root();
+
+    while (1) {
+        print_prompt();
+        read_line(line);
+        history_add(line);
+        run_line(line);
     }
 }
@@ -9,6 +9,11 @@ Description: Shell interface and command dispatcher declarations for the RISC-V
 
 extern "C" void shell_main();
 extern "C" char getchar();
+
+// Console input: processes blocked reading it, and a non-blocking check
+struct WaitQueue;
+extern WaitQueue console_waiters;
+bool console_has_input();
 extern "C" void putchar(char c);
 extern "C" void print_str(const char* s);
 extern "C" void print_hex(uint32_t val);
@@ -24,4 +29,38 @@ extern "C" void* memset(void* s, int c, int n);
 extern "C" void* memcpy(void* dest, const void* src, int n);
 void itoa(uint32_t value, char* str, int base = 10);
 
+// Exit status of the last shell command (0 = success), used by '&&'
+extern int shell_status;
+void shell_fail(const char* msg);
+
+// Shell command registration: a subsystem lists its commands in its own
+// header as CMD(name, handler, help) entries of an X-macro, and commands.h
+// collects every list into the dispatch table.
+#define SHELL_COMMANDS(CMD) \
+    CMD("help", cmd_help, "'help'\t\tShow this help message.") \
+    CMD("echo", cmd_echo, "'echo <args>'\tEcho arguments.") \
+    CMD("clear", cmd_clear, "'clear'\t\tClear the screen.") \
+    CMD("mkdir", cmd_mkdir, "'mkdir <name>'\tCreate a new directory.") \
+    CMD("rmdir", cmd_rmdir, "'rmdir <name>'\tRemove a directory.") \
+    CMD("ls", cmd_ls, "'ls'\t\tList files and directories.") \
+    CMD("touch", cmd_touch, "'touch <name>'\tCreate a new file.") \
+    CMD("rm", cmd_rm, "'rm [-r] <name>'\tDelete a file (or a directory tree).") \
+    CMD("cp", cmd_cp, "'cp [-r] <src> <dest>' Copy a file (or a directory tree).") \
+    CMD("du", cmd_du, "'du [dir]'\t\tShow bytes and files below a directory.") \
+    CMD("find", cmd_find, "'find <pattern>'\tList entries matching a * / ? pattern.") \
+    CMD("grep", cmd_grep, "'grep [-r] <re> <path>' Print lines matching a regex.") \
+    CMD("run", cmd_run, "'run <name>'\tRun a user program.") \
+    CMD("mv", cmd_mv, "'mv <src> <dest>'\tMove a file to another directory.") \
+    CMD("cd", cmd_cd, "'cd <dir>'\t\tChange current directory.") \
+    CMD("pwd", cmd_pwd, "'pwd'\t\tPrint current working directory.") \
+    CMD("cat", cmd_cat, "'cat <name>'\tDump a file's contents to the console.") \
+    CMD("edit", cmd_edit_wrapper, "'edit <name>'\tEdit a file in the full-screen editor.") \
+    CMD("append", cmd_append_wrapper, "'append <name>'\tEdit a file starting at its end.") \
+    CMD("ln", cmd_ln, "'ln <src> <dest>'\tCreate a hard link to a file.") \
+    CMD("stat", cmd_stat, "'stat <name>'\tShow a file's size, links, mode and times.") \
+    CMD("chmod", cmd_chmod, "'chmod <m> <name>'\tSet a file's permission bits.") \
+    CMD("source", cmd_source, "'source <file>'\tRun each line of a file as a command.") \
+    CMD("history", cmd_history, "'history'\t\tList recently entered commands.") \
+    CMD("exit", cmd_exit, "'exit'\t\tAdvises the user on how to exit the OS.")
+
 #endif
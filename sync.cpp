@@ -0,0 +1,293 @@
+/* Copyright (c) 2025, Rye Stahle-Smith
+December 2nd, 2025 - sync.cpp
+Description: Mutexes and condition variables built on wait queues, with transitive priority inheritance and release of a dead owner's locks. */
+#include "sync.h"
+#include "shell.h"
+#include "timer.h"
+
+static Mutex mutex_table[MAX_MUTEXES];
+static Cond cond_table[MAX_CONDS];
+static int next_mutex_id = 1;
+static int next_cond_id = 1;
+
+// Futex waiters hashed by address; each records its address in futex_addr
+static WaitQueue futex_buckets[FUTEX_BUCKETS];
+
+// ---------------------------------------------------------------------
+// Internal helpers
+// ---------------------------------------------------------------------
+static Mutex* mutex_get(int id) {
+    for (int i = 0; i < MAX_MUTEXES; ++i) {
+        if (mutex_table[i].in_use && mutex_table[i].id == id) return &mutex_table[i];
+    }
+    return nullptr;
+}
+
+static Cond* cond_get(int id) {
+    for (int i = 0; i < MAX_CONDS; ++i) {
+        if (cond_table[i].in_use && cond_table[i].id == id) return &cond_table[i];
+    }
+    return nullptr;
+}
+
+// The mutex whose wait queue p is on, if any
+static Mutex* mutex_waited_on(Process* p) {
+    if (p->state != PROC_BLOCKED || p->block_reason != BLOCK_MUTEX) return nullptr;
+    for (int i = 0; i < MAX_MUTEXES; ++i) {
+        if (mutex_table[i].in_use && p->wait_queue == &mutex_table[i].waiters) return &mutex_table[i];
+    }
+    return nullptr;
+}
+
+// Recompute an owner's effective priority from its base and its waiters
+static void update_priority(Process* p) {
+    int prio = sync_inherited_priority(p->pid);
+    p->priority = prio > p->base_priority ? prio : p->base_priority;
+}
+
+// Lend prio to the owner of m, and on down the chain if that owner is
+// itself blocked on another mutex
+static void inherit(Mutex* m, int prio) {
+    for (int depth = 0; m && depth < MAX_MUTEXES; ++depth) {
+        Process* owner = scheduler_get_proc_by_pid(m->owner_pid);
+        if (!owner || owner->priority >= prio) return;
+        owner->priority = prio;
+        m = mutex_waited_on(owner);
+    }
+}
+
+// Give m to its highest-priority waiter (FIFO among equals) or free it
+static void hand_off(Mutex* m) {
+    Process* best = nullptr;
+    for (Process* p = m->waiters.head; p; p = p->wait_next) {
+        if (!best || p->priority > best->priority) best = p;
+    }
+
+    m->owner_pid = best ? best->pid : 0;
+    if (!best) return;
+
+    wait_wake(best, WAIT_OK);
+    update_priority(best);  // inherits from whoever still waits on m
+}
+
+// Queue p (blocked) for m, or give m to it straight away if it is free
+static void acquire_or_queue(Mutex* m, Process* p) {
+    if (m->owner_pid == 0) {
+        m->owner_pid = p->pid;
+        wait_wake(p, WAIT_OK);
+        return;
+    }
+    wait_requeue(p, &m->waiters, BLOCK_MUTEX);
+    inherit(m, p->priority);
+}
+
+static WaitQueue* futex_bucket(volatile int32_t* addr) {
+    return &futex_buckets[((uintptr_t)addr >> 2) % FUTEX_BUCKETS];
+}
+
+static int unlock(Mutex* m) {
+    Process* owner = scheduler_get_proc_by_pid(m->owner_pid);
+    hand_off(m);
+    if (owner) update_priority(owner);
+    return 0;
+}
+
+// ---------------------------------------------------------------------
+// Public API
+// ---------------------------------------------------------------------
+void sync_init() {
+    for (int i = 0; i < MAX_MUTEXES; ++i) {
+        mutex_table[i].in_use = false;
+        mutex_table[i].owner_pid = 0;
+        wait_queue_init(&mutex_table[i].waiters);
+    }
+    for (int i = 0; i < MAX_CONDS; ++i) {
+        cond_table[i].in_use = false;
+        wait_queue_init(&cond_table[i].waiters);
+    }
+    for (int i = 0; i < FUTEX_BUCKETS; ++i) wait_queue_init(&futex_buckets[i]);
+    next_mutex_id = 1;
+    next_cond_id = 1;
+}
+
+int mutex_create() {
+    for (int i = 0; i < MAX_MUTEXES; ++i) {
+        Mutex* m = &mutex_table[i];
+        if (m->in_use) continue;
+
+        m->id = next_mutex_id++;
+        m->owner_pid = 0;
+        m->creator_pid = scheduler_current_tgid();
+        wait_queue_init(&m->waiters);
+        m->in_use = true;
+        return m->id;
+    }
+    return -1;
+}
+
+int mutex_lock(int id) {
+    Mutex* m = mutex_get(id);
+    if (!m || current <= 0 || m->owner_pid == current) return -1;  // not recursive
+
+    if (m->owner_pid == 0) {
+        m->owner_pid = current;
+        return 0;
+    }
+
+    Process* self = scheduler_get_proc_by_pid(current);
+    inherit(m, self->priority);
+    wait_block(&m->waiters, BLOCK_MUTEX, 0, false);  // woken as the new owner
+    return -1;  // not inside a syscall: cannot block
+}
+
+int mutex_unlock(int id) {
+    Mutex* m = mutex_get(id);
+    if (!m || m->owner_pid != current) return -1;
+    return unlock(m);
+}
+
+// Only an unlocked mutex nobody waits for can be destroyed
+int mutex_destroy(int id) {
+    Mutex* m = mutex_get(id);
+    if (!m || m->owner_pid != 0 || m->waiters.head) return -1;
+    m->in_use = false;
+    return 0;
+}
+
+int cond_create() {
+    for (int i = 0; i < MAX_CONDS; ++i) {
+        Cond* c = &cond_table[i];
+        if (c->in_use) continue;
+
+        c->id = next_cond_id++;
+        c->mutex_id = 0;
+        c->creator_pid = scheduler_current_tgid();
+        wait_queue_init(&c->waiters);
+        c->in_use = true;
+        return c->id;
+    }
+    return -1;
+}
+
+// Release the mutex and sleep; signal moves the waiter onto the mutex, so
+// it returns only once it owns the mutex again
+int cond_wait(int id, int mutex_id) {
+    Cond* c = cond_get(id);
+    Mutex* m = mutex_get(mutex_id);
+    if (!c || !m || m->owner_pid != current) return -1;
+    if (c->mutex_id != 0 && c->mutex_id != mutex_id && c->waiters.head) return -1;
+
+    c->mutex_id = mutex_id;
+    unlock(m);
+    wait_block(&c->waiters, BLOCK_COND, 0, false);
+    return -1;  // not inside a syscall: cannot block
+}
+
+int cond_signal(int id) {
+    Cond* c = cond_get(id);
+    if (!c) return -1;
+
+    Process* p = c->waiters.head;
+    Mutex* m = mutex_get(c->mutex_id);
+    if (p && m) acquire_or_queue(m, p);
+    return 0;
+}
+
+int cond_broadcast(int id) {
+    Cond* c = cond_get(id);
+    if (!c) return -1;
+
+    Mutex* m = mutex_get(c->mutex_id);
+    while (m && c->waiters.head) acquire_or_queue(m, c->waiters.head);
+    return 0;
+}
+
+int cond_destroy(int id) {
+    Cond* c = cond_get(id);
+    if (!c || c->waiters.head) return -1;
+    c->in_use = false;
+    return 0;
+}
+
+int futex_wait(volatile int32_t* addr, int32_t expected, uint64_t timeout_ms) {
+    Process* self = scheduler_get_proc_by_pid(current);
+    if (!self || !addr || ((uintptr_t)addr & 3)) return -1;
+    if (*addr != expected) return -1;  // changed already: do not sleep
+
+    self->futex_addr = (uintptr_t)addr;
+    wait_block(futex_bucket(addr), BLOCK_FUTEX, timeout_ms * TIMER_TICKS_PER_MS, false);
+    return -1;  // not inside a syscall: cannot block
+}
+
+int futex_wake(volatile int32_t* addr, int count) {
+    if (!addr || ((uintptr_t)addr & 3)) return -1;
+
+    int woken = 0;
+    Process* p = futex_bucket(addr)->head;
+    while (p && woken < count) {
+        Process* next = p->wait_next;
+        if (p->futex_addr == (uintptr_t)addr) {
+            p->futex_addr = 0;
+            wait_wake(p, WAIT_OK);
+            woken++;
+        }
+        p = next;
+    }
+    return woken;
+}
+
+int sync_inherited_priority(int pid) {
+    int prio = PRIO_LOW;
+    for (int i = 0; i < MAX_MUTEXES; ++i) {
+        Mutex* m = &mutex_table[i];
+        if (!m->in_use || m->owner_pid != pid) continue;
+        for (Process* p = m->waiters.head; p; p = p->wait_next) {
+            if (p->priority > prio) prio = p->priority;
+        }
+    }
+    return prio;
+}
+
+// Recompute the owner and, transitively, the owners it waits on, since the
+// departed waiter may have been what boosted them
+void sync_waiter_left(WaitQueue* q) {
+    Mutex* m = nullptr;
+    for (int i = 0; i < MAX_MUTEXES && !m; ++i) {
+        if (mutex_table[i].in_use && q == &mutex_table[i].waiters) m = &mutex_table[i];
+    }
+
+    for (int depth = 0; m && depth < MAX_MUTEXES; ++depth) {
+        Process* owner = scheduler_get_proc_by_pid(m->owner_pid);
+        if (!owner) return;
+        update_priority(owner);
+        m = mutex_waited_on(owner);
+    }
+}
+
+void sync_release(int pid) {
+    for (int i = 0; i < MAX_MUTEXES; ++i) {
+        Mutex* m = &mutex_table[i];
+        if (!m->in_use || m->owner_pid != pid) continue;
+
+        print_str("(sync) Releasing mutex held by exiting process\n");
+        hand_off(m);
+    }
+
+    for (int i = 0; i < MAX_CONDS; ++i) {
+        Cond* c = &cond_table[i];
+        if (!c->in_use || c->creator_pid != pid) continue;
+        wait_wake_all(&c->waiters, WAIT_DESTROYED);
+        c->in_use = false;
+    }
+
+    for (int i = 0; i < MAX_MUTEXES; ++i) {
+        Mutex* m = &mutex_table[i];
+        if (!m->in_use || m->creator_pid != pid) continue;
+
+        Process* owner = scheduler_get_proc_by_pid(m->owner_pid);
+        wait_wake_all(&m->waiters, WAIT_DESTROYED);
+        m->in_use = false;
+        m->owner_pid = 0;
+        if (owner) update_priority(owner);  // nothing left to inherit from m
+    }
+}
@@ -0,0 +1,78 @@
+/* Copyright (c) 2025, Rye Stahle-Smith
+December 2nd, 2025 - sync.h
+Description: Kernel mutexes with owner tracking and priority inheritance, condition variables bound to a mutex, and futexes for user-space synchronization. */
+#ifndef SYNC_H
+#define SYNC_H
+
+#pragma once
+#include <stdint.h>
+#include "scheduler.h"
+
+#define MAX_MUTEXES 32
+#define MAX_CONDS 32
+
+#define SYSCALL_MUTEX_CREATE 180
+#define SYSCALL_MUTEX_LOCK 181
+#define SYSCALL_MUTEX_UNLOCK 182
+#define SYSCALL_MUTEX_DESTROY 183
+#define SYSCALL_COND_CREATE 184
+#define SYSCALL_COND_WAIT 185
+#define SYSCALL_COND_SIGNAL 186
+#define SYSCALL_COND_BROADCAST 187
+#define SYSCALL_COND_DESTROY 188
+#define SYSCALL_FUTEX_WAIT 196
+#define SYSCALL_FUTEX_WAKE 197
+
+#define FUTEX_BUCKETS 8
+
+struct Mutex {
+    int id;
+    int owner_pid;      // holder, 0 when unlocked
+    int creator_pid;    // destroyed when this process exits
+    WaitQueue waiters;  // processes blocked in mutex_lock
+    bool in_use;
+};
+
+struct Cond {
+    int id;
+    int mutex_id;       // mutex the waiters hold; bound by the first wait
+    int creator_pid;    // destroyed when this process exits
+    WaitQueue waiters;  // processes blocked in cond_wait
+    bool in_use;
+};
+
+void sync_init();
+
+// All return 0 on success or -1 (bad id, not the owner, would deadlock).
+// mutex_lock and cond_wait block; ownership is handed directly to the
+// waiter being woken, so they return holding the mutex.
+int mutex_create();
+int mutex_lock(int id);
+int mutex_unlock(int id);
+int mutex_destroy(int id);
+
+int cond_create();
+int cond_wait(int id, int mutex_id);
+int cond_signal(int id);
+int cond_broadcast(int id);
+int cond_destroy(int id);
+
+// Futexes: park on a 32-bit user word without any kernel object. futex_wait
+// sleeps only while *addr still equals expected (else returns -1 at once)
+// and returns 0 when woken or WAIT_TIMEOUT; futex_wake wakes up to count
+// waiters on addr and returns how many it woke.
+int futex_wait(volatile int32_t* addr, int32_t expected, uint64_t timeout_ms);
+int futex_wake(volatile int32_t* addr, int count);
+
+// Highest priority among processes waiting on mutexes pid holds
+int sync_inherited_priority(int pid);
+
+// A waiter left q (a mutex's wait queue) without being handed the mutex,
+// e.g. it timed out or was killed: take back what it lent the owner
+void sync_waiter_left(WaitQueue* q);
+
+// Exit cleanup: unlock every mutex the process still holds, and destroy the
+// mutexes and condition variables it created (waiters get WAIT_DESTROYED)
+void sync_release(int pid);
+
+#endif
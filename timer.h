@@ -0,0 +1,19 @@
+/* Copyright (c) 2025, Rye Stahle-Smith
+December 2nd, 2025 - timer.h
+Description: Platform timer definitions shared by the kernel: the machine timer's tick rate and a reader for the current tick count. */
+#ifndef TIMER_H
+#define TIMER_H
+
+#pragma once
+#include <stdint.h>
+
+constexpr uint64_t TIMER_TICKS_PER_MS = 10000;  // QEMU virt timebase is 10 MHz
+
+// Ticks since reset (the time CSR)
+static inline uint64_t timer_now() {
+    uint64_t t;
+    asm volatile("rdtime %0" : "=r"(t));
+    return t;
+}
+
+#endif
@@ -1,96 +1,504 @@
 /* Copyright (c) 2025, Rye Stahle-Smith
 December 2nd, 2025 - trap.cpp
-Description: Trap handler with syscall support for exit, yield, and semaphore operations. */
+Description: Trap handler that emulates misaligned accesses and missing instructions, kills faulting user programs (and dumps state on kernel faults), with syscall support for exit, yield, semaphore operations, mutexes and condition variables, file reads, pipes, asynchronous I/O, and pattern search. */
 #include <stdint.h>
 #include "scheduler.h"
 #include "shell.h"
+#include "fat.h"
+#include "timer.h"
+#include "io.h"
+#include "search.h"
+#include "pipe.h"
+#include "sync.h"
+#include "emulate.h"
 
 volatile uint64_t* const UART0 = (uint64_t*)0x10000000;
 
-extern "C" void trap_handler() {
-    uint64_t cause;
-    asm volatile("csrr %0, mcause" : "=r"(cause));
+// ---------------------------------------------------------------------
+// File syscalls (descriptors index the fds[] table of the current process,
+// which all of its threads share through the group leader)
+// ---------------------------------------------------------------------
+static FileDesc* fd_lookup(int fd) {
+    Process* p = scheduler_get_leader(current);
+    if (!p || fd < 0 || fd >= MAX_FDS || p->fds[fd].kind == FD_NONE) return nullptr;
+    return &p->fds[fd];
+}
+
+// Lowest unused descriptor of the current process, or -1
+static int fd_alloc() {
+    Process* p = scheduler_get_leader(current);
+    if (!p) return -1;
+    for (int fd = 0; fd < MAX_FDS; ++fd) {
+        if (p->fds[fd].kind == FD_NONE) return fd;
+    }
+    return -1;
+}
+
+static int64_t sys_open(const char* path) {
+    int fd = fd_alloc();
+    if (fd < 0) return -1; // descriptor table full
+
+    OpenFile* of = fat.open(fat.resolve_file(fat.get_root(), path));
+    if (!of) return -1;
+    scheduler_get_leader(current)->fds[fd] = { FD_FILE, of, nullptr };
+    return fd;
+}
+
+static int64_t sys_close(int fd) {
+    FileDesc* d = fd_lookup(fd);
+    if (!d) return -1;
+    fd_release(d);
+    return 0;
+}
+
+// Descriptor 0 that was never assigned reads the console: whatever input is
+// waiting, blocking until at least one byte arrives
+static int64_t console_read(char* buf, int len) {
+    if (len == 0) return 0;
+    if (!console_has_input()) wait_block(&console_waiters, BLOCK_UART, 0, true);
+
+    int n = 0;
+    while (n < len && console_has_input()) buf[n++] = getchar();
+    return n;
+}
+
+// Pipe reads block while the pipe is empty and a writer remains; a drained
+// pipe with no writers reads as end of file
+static int64_t sys_read(int fd, void* buf, int len) {
+    Process* p = scheduler_get_leader(current);
+    if (p && fd == 0 && p->fds[0].kind == FD_NONE && buf && len >= 0) {
+        return console_read((char*)buf, len);
+    }
+
+    FileDesc* d = fd_lookup(fd);
+    if (!d) return -1;
+    if (d->kind == FD_FILE) return fat.read(d->file, buf, len);
+    if (d->kind != FD_PIPE_READ || !buf || len < 0) return -1;
+
+    int n = pipe_read(d->pipe, buf, len);
+    if (n == 0 && len > 0 && d->pipe->writers > 0) pipe_wait(d->pipe, false);
+    return n;
+}
+
+// Descriptors 0-2 that were never assigned write to the console. Pipe
+// writes may be short and block only while the pipe is completely full.
+static int64_t sys_write(int fd, const void* buf, int len) {
+    if (!buf || len < 0) return -1;
+
+    Process* p = scheduler_get_leader(current);
+    if (p && fd >= 0 && fd <= 2 && p->fds[fd].kind == FD_NONE) {
+        const char* c = (const char*)buf;
+        for (int i = 0; i < len; i++) *UART0 = (uint64_t)c[i];
+        return len;
+    }
+
+    FileDesc* d = fd_lookup(fd);
+    if (!d || d->kind != FD_PIPE_WRITE) return -1;
+
+    int n = pipe_write(d->pipe, buf, len);
+    if (n == 0 && len > 0) pipe_wait(d->pipe, true);
+    return n;
+}
+
+static int64_t sys_lseek(int fd, int offset) {
+    FileDesc* d = fd_lookup(fd);
+    if (!d || d->kind != FD_FILE || !fat.seek(d->file, offset)) return -1;
+    return offset;
+}
+
+// fds[0] = read end, fds[1] = write end
+static int64_t sys_pipe(int* fds) {
+    Process* p = scheduler_get_leader(current);
+    if (!p || !fds) return -1;
+
+    int rfd = fd_alloc();
+    if (rfd < 0) return -1;
+    p->fds[rfd].kind = FD_PIPE_READ;  // reserve while finding the second slot
+    int wfd = fd_alloc();
+    p->fds[rfd].kind = FD_NONE;
+    if (wfd < 0) return -1;
+
+    Pipe* pipe = pipe_create();
+    if (!pipe) return -1;
+
+    p->fds[rfd] = { FD_PIPE_READ, nullptr, pipe };
+    p->fds[wfd] = { FD_PIPE_WRITE, nullptr, pipe };
+    fds[0] = rfd;
+    fds[1] = wfd;
+    return 0;
+}
+
+// Make newfd refer to what oldfd refers to, closing newfd first
+static int64_t sys_dup2(int oldfd, int newfd) {
+    FileDesc* d = fd_lookup(oldfd);
+    if (!d || newfd < 0 || newfd >= MAX_FDS) return -1;
+    if (oldfd == newfd) return newfd;
+
+    FileDesc* target = &scheduler_get_leader(current)->fds[newfd];
+    fd_release(target);
+
+    if (d->kind == FD_FILE) fat.dup(d->file);
+    else pipe_retain(d->pipe, d->kind == FD_PIPE_WRITE);
+    *target = *d;
+    return newfd;
+}
 
-    if (cause == 11) { // Environment call from U-mode
-        uint64_t syscall_id;
-        asm volatile("mv %0, a7" : "=r"(syscall_id));
+// Search a user buffer; the compiled pattern is kept off the user stack
+static int64_t sys_regex_search(const char* pattern, const uint8_t* buf, int len) {
+    static Regex re;
+    if (!pattern || !buf || len < 0 || !regex_compile(&re, pattern)) return -1;
+    return regex_search(&re, buf, len);
+}
+
+// ---------------------------------------------------------------------
+// Faults
+// ---------------------------------------------------------------------
+extern uint8_t _kernel_heap_start;  // kernel stacks lie between these (linker.ld)
+extern uint8_t _stack_start;
+
+static const char* const exception_names[16] = {
+    "instruction address misaligned", "instruction access fault",
+    "illegal instruction", "breakpoint",
+    "load address misaligned", "load access fault",
+    "store address misaligned", "store access fault",
+    nullptr, nullptr, nullptr, nullptr,
+    "instruction page fault", "load page fault", nullptr, "store page fault"
+};
+
+// TrapFrame slots in order (see scheduler.h)
+static const char* const frame_reg_names[31] = {
+    "ra", "gp", "tp", "t0", "t1", "t2", "t3", "t4", "t5", "t6",
+    "s0", "s1", "s2", "s3", "s4", "s5", "s6", "s7", "s8", "s9", "s10", "s11",
+    "a0", "a1", "a2", "a3", "a4", "a5", "a6", "a7", "sp"
+};
+
+static void print_hex64(uint64_t val) {
+    char buf[19];
+    buf[0] = '0';
+    buf[1] = 'x';
+    for (int i = 15; i >= 0; i--) {
+        uint8_t nibble = (val >> (i * 4)) & 0xF;
+        buf[17 - i] = (nibble < 10) ? ('0' + nibble) : ('a' + nibble - 10);
+    }
+    buf[18] = '\0';
+    print_str(buf);
+}
+
+static void print_cause(uint64_t cause) {
+    const char* name = cause < 16 ? exception_names[cause] : nullptr;
+    if (name) {
+        print_str(name);
+    } else {
+        print_str("mcause ");
+        print_hex64(cause);
+    }
+}
+
+// Taken while a user program ran (not while the kernel handled a trap for
+// it), so only that program is at fault. The shell and other kernel
+// processes have no loaded image.
+static bool is_user_fault(const TrapFrame* tf) {
+    if (!tf->scratch || (int64_t)tf->cause < 0) return false;  // kernel code, or an interrupt
+    Process* leader = scheduler_get_leader(current);
+    return leader && leader->code;
+}
+
+static void kill_faulting_process(const TrapFrame* tf, uint64_t mtval) {
+    Process* self = scheduler_get_proc_by_pid(current);
+    char buf[16];
+    itoa(current, buf, 10);
+
+    print_str("(trap) Killed PID ");
+    print_str(buf);
+    print_str(" '");
+    print_str(self ? self->name : "?");
+    print_str("': ");
+    print_cause(tf->cause);
+    print_str(" at pc=");
+    print_hex64(tf->epc);
+    print_str(" mtval=");
+    print_hex64(mtval);
+    print_str("\n");
+
+    scheduler_kill_current();
+}
 
-        // Read syscall arguments from registers
-        uint64_t arg0, arg1, arg2, arg3;
-        asm volatile("mv %0, a0" : "=r"(arg0));
-        asm volatile("mv %0, a1" : "=r"(arg1));
-        asm volatile("mv %0, a2" : "=r"(arg2));
-        asm volatile("mv %0, a3" : "=r"(arg3));
+// Frame-pointer walk from the faulting frame: the saved ra sits at fp-8 and
+// the caller's fp at fp-16. Only builds with frame pointers (make
+// KMEM_DEBUG=1) keep s0 a frame pointer; otherwise the walk stops early.
+static void print_backtrace(const TrapFrame* tf) {
+    print_str("Backtrace:\n  ");
+    print_hex64(tf->epc);
+    print_str("\n  ");
+    print_hex64(tf->ra);
+    print_str("\n");
+
+    uint64_t fp = tf->s0;
+    for (int depth = 0; depth < 16; ++depth) {
+        if ((fp & 7) || fp <= (uint64_t)&_kernel_heap_start || fp > (uint64_t)&_stack_start) break;
+        uint64_t pc = ((uint64_t*)fp)[-1];
+        uint64_t caller = ((uint64_t*)fp)[-2];
+        if (pc != tf->ra || depth > 0) {
+            print_str("  ");
+            print_hex64(pc);
+            print_str("\n");
+        }
+        if (caller <= fp) break;  // stacks grow down: callers sit higher
+        fp = caller;
+    }
+}
+
+// A fault in the kernel itself: nothing can be trusted, so report
+// everything and stop
+static void kernel_panic(const TrapFrame* tf, uint64_t mtval) {
+    print_str("\n(trap) Kernel fault: ");
+    print_cause(tf->cause);
+    print_str("\n  pc  ");
+    print_hex64(tf->epc);
+    print_str("  mtval ");
+    print_hex64(mtval);
+    print_str("  PID ");
+    char buf[16];
+    itoa(current, buf, 10);
+    print_str(buf);
+    print_str("\n");
+
+    const uint64_t* regs = (const uint64_t*)tf;
+    for (int i = 0; i < 31; ++i) {
+        print_str("  ");
+        const char* name = frame_reg_names[i];
+        print_str(name);
+        if (!name[2]) putchar(' ');
+        putchar(' ');
+        print_hex64(regs[i]);
+        if (i % 4 == 3 || i == 30) print_str("\n");
+    }
+    print_backtrace(tf);
+
+    while (1) asm volatile("wfi");
+}
+
+// Returns nonzero when the calling process stopped inside its syscall;
+// trap_vector then saves the rest of the frame and switches away
+extern "C" int trap_handler(TrapFrame* tf) {
+    uint64_t cause = tf->cause;
+
+    if (cause == 11) { // Environment call from M-mode
+        uint64_t syscall_id = tf->a7;
+
+        // Where a blocking syscall resumes (see wait_block)
+        Process* self = scheduler_get_proc_by_pid(current);
+        if (self) {
+            self->resume_pc = tf->epc;
+            self->tf = tf;
+        }
+
+        // Syscall arguments as saved by trap_vector
+        uint64_t arg0 = tf->a0;
+        uint64_t arg1 = tf->a1;
+        uint64_t arg2 = tf->a2;
 
         int64_t result = -1;
 
         if (syscall_id == SYSCALL_EXIT) {
-            // Exit current process
-            if (current > 0) {
-                terminate_process(current);
-            }
-            asm volatile("csrw mepc, %0" :: "r"(kernel_resume_pc));
-            return;
+            // arg0 = exit value; ends the calling thread (does not return)
+            scheduler_exit_current((int64_t)arg0);
         }
         
         else if (syscall_id == SYSCALL_YIELD) {
-            // Yield to scheduler (mark as ready, jump back)
-            Process* p = scheduler_get_proc_by_pid(current);
-            if (p && p->state == PROC_RUNNING) {
-                p->state = PROC_READY;
-            }
-            asm volatile("csrw mepc, %0" :: "r"(kernel_resume_pc));
-            return;
+            // Stay ready and let the scheduler run someone else; resumes here
+            scheduler_yield_current();
+            result = 0;
+        }
+
+        else if (syscall_id == SYSCALL_THREAD_CREATE) {
+            // arg0 = entry, arg1 = argument (a0 at entry), arg2 = stack size (0 = default)
+            result = thread_create((void(*)())arg0, arg1, (uint32_t)arg2);
+        }
+
+        else if (syscall_id == SYSCALL_THREAD_EXIT) {
+            // arg0 = value returned to the joiner (does not return)
+            scheduler_exit_current((int64_t)arg0);
+        }
+
+        else if (syscall_id == SYSCALL_THREAD_JOIN) {
+            // arg0 = thread id, arg1 = int64_t* receiving the exit value (may be 0)
+            result = thread_join((int)arg0, (int64_t*)arg1);
+        }
+
+        else if (syscall_id == SYSCALL_SLEEP) {
+            // arg0 = milliseconds; sleeping for 0 is a yield
+            if (arg0) wait_block(nullptr, BLOCK_SLEEP, arg0 * TIMER_TICKS_PER_MS, false);
+            else scheduler_yield_current();
+            result = 0;
         }
         
         else if (syscall_id == SYSCALL_SEM_CREATE) {
             // arg0 = initial value
             result = sem_create((int)arg0);
-            // Return value in a0
-            asm volatile("mv a0, %0" :: "r"(result));
         }
         
         else if (syscall_id == SYSCALL_SEM_WAIT) {
             // arg0 = semaphore id
-            sem_wait((int)arg0);
-            result = 0;
-            asm volatile("mv a0, %0" :: "r"(result));
+            result = sem_wait((int)arg0);
+        }
+
+        else if (syscall_id == SYSCALL_SEM_TIMEDWAIT) {
+            // arg0 = semaphore id, arg1 = timeout in ms (0 = forever)
+            result = sem_wait((int)arg0, arg1);
         }
         
         else if (syscall_id == SYSCALL_SEM_SIGNAL) {
             // arg0 = semaphore id
             sem_signal((int)arg0);
             result = 0;
-            asm volatile("mv a0, %0" :: "r"(result));
         }
         
         else if (syscall_id == SYSCALL_SEM_DESTROY) {
             // arg0 = semaphore id
             result = sem_destroy((int)arg0) ? 0 : -1;
-            asm volatile("mv a0, %0" :: "r"(result));
+        }
+
+        else if (syscall_id == SYSCALL_SETPRIORITY) {
+            // arg0 = pid (0 = self), arg1 = priority (PRIO_LOW..PRIO_MAX)
+            result = scheduler_set_priority(arg0 ? (int)arg0 : current, (int)arg1);
+        }
+
+        else if (syscall_id == SYSCALL_MUTEX_CREATE) {
+            result = mutex_create();
+        }
+
+        else if (syscall_id == SYSCALL_MUTEX_LOCK) {
+            // arg0 = mutex id
+            result = mutex_lock((int)arg0);
+        }
+
+        else if (syscall_id == SYSCALL_MUTEX_UNLOCK) {
+            // arg0 = mutex id
+            result = mutex_unlock((int)arg0);
+        }
+
+        else if (syscall_id == SYSCALL_MUTEX_DESTROY) {
+            // arg0 = mutex id
+            result = mutex_destroy((int)arg0);
+        }
+
+        else if (syscall_id == SYSCALL_COND_CREATE) {
+            result = cond_create();
+        }
+
+        else if (syscall_id == SYSCALL_COND_WAIT) {
+            // arg0 = condition id, arg1 = mutex id (held by the caller)
+            result = cond_wait((int)arg0, (int)arg1);
+        }
+
+        else if (syscall_id == SYSCALL_COND_SIGNAL) {
+            // arg0 = condition id
+            result = cond_signal((int)arg0);
+        }
+
+        else if (syscall_id == SYSCALL_COND_BROADCAST) {
+            // arg0 = condition id
+            result = cond_broadcast((int)arg0);
+        }
+
+        else if (syscall_id == SYSCALL_COND_DESTROY) {
+            // arg0 = condition id
+            result = cond_destroy((int)arg0);
+        }
+
+        else if (syscall_id == SYSCALL_FUTEX_WAIT) {
+            // arg0 = int32_t address, arg1 = expected value, arg2 = timeout in ms (0 = forever)
+            result = futex_wait((volatile int32_t*)arg0, (int32_t)arg1, arg2);
+        }
+
+        else if (syscall_id == SYSCALL_FUTEX_WAKE) {
+            // arg0 = int32_t address, arg1 = maximum waiters to wake
+            result = futex_wake((volatile int32_t*)arg0, (int)arg1);
+        }
+
+        else if (syscall_id == SYSCALL_OPEN) {
+            // arg0 = path (absolute, or relative to root)
+            result = sys_open((const char*)arg0);
+        }
+
+        else if (syscall_id == SYSCALL_CLOSE) {
+            // arg0 = fd
+            result = sys_close((int)arg0);
+        }
+
+        else if (syscall_id == SYSCALL_READ) {
+            // arg0 = fd, arg1 = buffer, arg2 = length
+            result = sys_read((int)arg0, (void*)arg1, (int)arg2);
+        }
+
+        else if (syscall_id == SYSCALL_WRITE) {
+            // arg0 = fd, arg1 = buffer, arg2 = length
+            result = sys_write((int)arg0, (const void*)arg1, (int)arg2);
+        }
+
+        else if (syscall_id == SYSCALL_PIPE) {
+            // arg0 = int[2] receiving the read and write descriptors
+            result = sys_pipe((int*)arg0);
+        }
+
+        else if (syscall_id == SYSCALL_DUP2) {
+            // arg0 = old fd, arg1 = new fd
+            result = sys_dup2((int)arg0, (int)arg1);
+        }
+
+        else if (syscall_id == SYSCALL_LSEEK) {
+            // arg0 = fd, arg1 = absolute offset
+            result = sys_lseek((int)arg0, (int)arg1);
+        }
+
+        else if (syscall_id == SYSCALL_IO_SUBMIT) {
+            // arg0 = IoSqe array, arg1 = count
+            result = io_submit_batch((const IoSqe*)arg0, (int)arg1);
+        }
+
+        else if (syscall_id == SYSCALL_IO_WAIT) {
+            // arg0 = IoCqe array, arg1 = max entries, arg2 = min completions
+            result = io_wait((IoCqe*)arg0, (int)arg1, (int)arg2);
+        }
+
+        else if (syscall_id == SYSCALL_REGEX_SEARCH) {
+            // arg0 = pattern, arg1 = buffer, arg2 = length
+            result = sys_regex_search((const char*)arg0, (const uint8_t*)arg1, (int)arg2);
+        }
+
+        else if (syscall_id == SYSCALL_GETPID) {
+            result = scheduler_current_tgid();
         }
         
         else {
             print_str("Error: Unknown syscall ");
             print_hex(syscall_id);
             print_str("\n");
-            asm volatile("csrw mepc, %0" :: "r"(kernel_resume_pc));
-            return;
         }
 
+        // Blocked or yielded: resume_process supplies a0 and mepc later
+        if (scheduler_switch_pending()) return 1;
+
+        // Returning normally: no saved context to resume from
+        if (self) self->tf = nullptr;
+
+        // Return value in a0 (restored from the frame by trap_vector)
+        tf->a0 = (uint64_t)result;
+
         // Advance mepc past ecall instruction (add 4 bytes)
-        uint64_t mepc;
-        asm volatile("csrr %0, mepc" : "=r"(mepc));
-        mepc += 4;
-        asm volatile("csrw mepc, %0" :: "r"(mepc));
-        
-        return;
+        tf->epc += 4;
+        return 0;
     }
 
-    // Unhandled trap
-    print_str("Error: Unhandled trap! mcause = ");
-    print_hex(cause);
-    print_str("\n");
+    // Exceptions: emulate what the hart lacks, otherwise a user program
+    // dies alone and a kernel fault halts
+    if (emulate_trap(tf)) return 0;
 
-    while (1) asm volatile("wfi");
+    uint64_t mtval;
+    asm volatile("csrr %0, mtval" : "=r"(mtval));
+
+    if (is_user_fault(tf)) kill_faulting_process(tf, mtval);  // does not return
+    kernel_panic(tf, mtval);
+    return 0;
 }
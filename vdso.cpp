@@ -0,0 +1,32 @@
+/* Copyright (c) 2025, Rye Stahle-Smith
+December 2nd, 2025 - vdso.cpp
+Description: Kernel side of the vDSO data page: sets the clock base at boot and tracks the running thread for trap-free reads by user programs. */
+#include "vdso.h"
+#include "timer.h"
+
+// Placed on its own page by linker.ld (section .vdso)
+VdsoPage vdso_page __attribute__((section(".vdso"), aligned(4096)));
+
+void vdso_init() {
+    uint64_t hartid;
+    asm volatile("csrr %0, mhartid" : "=r"(hartid));
+
+    vdso_page.version = VDSO_VERSION;
+    vdso_page.hartid = (uint32_t)hartid;
+    vdso_page.clock_base = timer_now();
+    vdso_page.ticks_per_ms = TIMER_TICKS_PER_MS;
+    vdso_page.coarse_ms = 0;
+    vdso_page.tid = 0;
+    vdso_page.pid = 0;
+}
+
+// Aligned 32- and 64-bit stores are single-copy atomic, so a reader never
+// sees a torn field; one hart means no reader runs during the update anyway
+void vdso_switch(int tid, int pid) {
+    vdso_page.tid = tid;
+    vdso_page.pid = pid;
+}
+
+void vdso_update_clock() {
+    vdso_page.coarse_ms = (timer_now() - vdso_page.clock_base) / TIMER_TICKS_PER_MS;
+}
@@ -0,0 +1,38 @@
+/* Copyright (c) 2025, Rye Stahle-Smith
+December 2nd, 2025 - vdso.h
+Description: vDSO-style data page shared with user programs: clock base and timebase for trap-free timekeeping, plus the running thread's IDs and hart. */
+#ifndef VDSO_H
+#define VDSO_H
+
+#pragma once
+#include <stdint.h>
+
+#define VDSO_VERSION 1
+
+// One page in its own linker section, written only by the kernel. A
+// process gets its address in a1 at entry; user programs read it with
+// plain loads (see user_programs/runtime/vdso.inc, which mirrors these
+// offsets) and read the clock with rdtime, so neither needs an ecall.
+struct VdsoPage {
+    uint32_t version;       // VDSO_VERSION
+    uint32_t hartid;        // hart this page describes
+    uint64_t clock_base;    // rdtime at boot: uptime ticks = rdtime - clock_base
+    uint64_t ticks_per_ms;  // timebase
+    uint64_t coarse_ms;     // uptime in ms at the last scheduler pass
+    int32_t tid;            // thread running on the hart
+    int32_t pid;            // its process (what getpid returns)
+};
+
+static_assert(__builtin_offsetof(VdsoPage, clock_base) == 8, "vdso.inc offsets");
+static_assert(__builtin_offsetof(VdsoPage, ticks_per_ms) == 16, "vdso.inc offsets");
+static_assert(__builtin_offsetof(VdsoPage, coarse_ms) == 24, "vdso.inc offsets");
+static_assert(__builtin_offsetof(VdsoPage, tid) == 32, "vdso.inc offsets");
+static_assert(__builtin_offsetof(VdsoPage, pid) == 36, "vdso.inc offsets");
+
+extern "C" VdsoPage vdso_page;
+
+void vdso_init();                    // at boot: version, hart and clock base
+void vdso_switch(int tid, int pid);  // the scheduler changed the running thread
+void vdso_update_clock();            // refresh coarse_ms
+
+#endif